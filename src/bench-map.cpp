@@ -0,0 +1,85 @@
+// Map benchmark, built as its own executable (MapBenchExe) so the engine entry point stays free of it.
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+#include "util/containers.h"
+#include "util/types.h"
+
+namespace
+{
+using namespace ember;
+
+// Average ns per op for insert, lookup hit, lookup miss and erase over keys. misses are keys not in keys.
+template<typename Map, typename Key>
+void BenchmarkMap(const char* name, const embLargeArray<Key>& keys, const embLargeArray<Key>& misses) noexcept
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr embU32 LOOKUP_ROUNDS = 4;
+    const auto toNsPerOp = [](Clock::duration time, embSizeT ops) {
+        return (embF64)std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / (embF64)ops;
+    };
+
+    Map map;
+    embU64 checksum = 0; // keeps the lookups from being optimized out
+
+    const Clock::time_point insertStart = Clock::now();
+    for (embU32 i = 0; i < keys.size(); i++)
+        map[keys[i]] = i;
+
+    const Clock::time_point hitStart = Clock::now();
+    for (embU32 round = 0; round < LOOKUP_ROUNDS; round++)
+    {
+        for (const Key key : keys)
+            checksum += map.find(key)->second;
+    }
+
+    const Clock::time_point missStart = Clock::now();
+    for (const Key key : misses)
+        checksum += map.count(key);
+
+    const Clock::time_point eraseStart = Clock::now();
+    for (const Key key : keys)
+        checksum += map.erase(key);
+    const Clock::time_point end = Clock::now();
+
+    std::print("  {:<20} insert {:6.1f}  hit {:6.1f}  miss {:6.1f}  erase {:6.1f}  ns/op  (checksum {})\n", name,
+               toNsPerOp(hitStart - insertStart, keys.size()), toNsPerOp(missStart - hitStart, keys.size() * LOOKUP_ROUNDS),
+               toNsPerOp(eraseStart - missStart, misses.size()), toNsPerOp(end - eraseStart, keys.size()), checksum);
+}
+
+// embMap vs std::unordered_map on the key shapes the engine uses, dense u32 ids (resource handle keys)
+// and random u64 (guids, hashes). Only meaningful in a release build.
+void RunMapBenchmarks() noexcept
+{
+    std::mt19937_64 rng(1234);
+    for (const embU32 count : {1u << 10, 1u << 16, 1u << 20})
+    {
+        embLargeArray<embU32> denseKeys, denseMisses;
+        embLargeArray<embU64> randomKeys, randomMisses;
+        for (embU32 i = 0; i < count; i++)
+        {
+            denseKeys.push_back(i);
+            denseMisses.push_back(count + i);
+            randomKeys.push_back(rng() | 1); // odd keys hit, even keys miss
+            randomMisses.push_back(rng() & ~1ull);
+        }
+        std::shuffle(denseKeys.begin(), denseKeys.end(), rng); // random access order, ids still dense
+
+        std::print("{} keys\n", count);
+        BenchmarkMap<embMap<embU32, embU32>>("embMap u32", denseKeys, denseMisses);
+        BenchmarkMap<std::unordered_map<embU32, embU32>>("unordered_map u32", denseKeys, denseMisses);
+        BenchmarkMap<embMap<embU64, embU32>>("embMap u64", randomKeys, randomMisses);
+        BenchmarkMap<std::unordered_map<embU64, embU32>>("unordered_map u64", randomKeys, randomMisses);
+    }
+}
+} // namespace
+
+int main()
+{
+    RunMapBenchmarks();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "clockstats.h"
+
+EMB_NAMESPACE_START
+
+constexpr embU64 CLOCKSTATS_WINDOW_MASK = CLOCKSTATS_WINDOW_SIZE - 1;
+
+void ClockStats::Record(ClockStat stat, embF32 value) noexcept
+{
+    EMB_ASSERT_HARD(stat < ClockStat::ENUM_COUNT, "stat out of range");
+
+    const embU64 slot = m_FrameCount.load(std::memory_order_relaxed) & CLOCKSTATS_WINDOW_MASK;
+    m_Windows[(embSizeT)stat][slot].store(value, std::memory_order_relaxed);
+}
+
+void ClockStats::CommitFrame() noexcept
+{
+    // release: readers that see the new count also see the values recorded for it.
+    m_FrameCount.fetch_add(1, std::memory_order_release);
+}
+
+void ClockStats::Reset() noexcept
+{
+    m_FrameCount.store(0, std::memory_order_release);
+}
+
+embU64 ClockStats::GetFrameCount() const noexcept
+{
+    return m_FrameCount.load(std::memory_order_acquire);
+}
+
+embF32 ClockStats::GetLatest(ClockStat stat) const noexcept
+{
+    EMB_ASSERT_HARD(stat < ClockStat::ENUM_COUNT, "stat out of range");
+
+    const embU64 frameCount = m_FrameCount.load(std::memory_order_acquire);
+    if (frameCount == 0)
+        return 0.f;
+
+    return m_Windows[(embSizeT)stat][(frameCount - 1) & CLOCKSTATS_WINDOW_MASK].load(std::memory_order_relaxed);
+}
+
+embU32 ClockStats::CopyWindow(ClockStat stat, embFixedSizeArray<embF32, CLOCKSTATS_WINDOW_SIZE>& out) const noexcept
+{
+    EMB_ASSERT_HARD(stat < ClockStat::ENUM_COUNT, "stat out of range");
+
+    const embU64 frameCount = m_FrameCount.load(std::memory_order_acquire);
+    const embU32 sampleCount = (embU32)std::min<embU64>(frameCount, CLOCKSTATS_WINDOW_SIZE);
+
+    // order doesn't matter for any of the queries, copy straight from slot 0.
+    const StatWindow& window = m_Windows[(embSizeT)stat];
+    for (embU32 i = 0; i < sampleCount; i++)
+        out[i] = window[i].load(std::memory_order_relaxed);
+
+    return sampleCount;
+}
+
+ClockStatSummary ClockStats::GetSummary(ClockStat stat) const noexcept
+{
+    embFixedSizeArray<embF32, CLOCKSTATS_WINDOW_SIZE> samples;
+    ClockStatSummary summary;
+    summary.sampleCount = CopyWindow(stat, samples);
+    if (summary.sampleCount == 0)
+        return summary;
+
+    embF32* begin = samples.data();
+    embF32* end = begin + summary.sampleCount;
+
+    // nearest-rank percentiles. Walk up from p50 so each nth_element only partitions what's left above the last one.
+    const auto percentile = [&](embF32 p, embF32* from) -> embF32* {
+        embF32* nth = begin + std::min((embU32)std::ceil(p * (embF32)summary.sampleCount), summary.sampleCount) - 1;
+        std::nth_element(from, nth, end);
+        return nth;
+    };
+
+    embF32* p50 = percentile(0.50f, begin);
+    embF32* p95 = percentile(0.95f, p50);
+    embF32* p99 = percentile(0.99f, p95);
+    summary.p50 = *p50;
+    summary.p95 = *p95;
+    summary.p99 = *p99;
+    summary.max = *std::max_element(p99, end);
+
+    embF64 sum = 0.0;
+    for (embF32* it = begin; it != end; it++)
+        sum += *it;
+    summary.mean = (embF32)(sum / summary.sampleCount);
+
+    return summary;
+}
+
+embU32 ClockStats::GetHistogram(ClockStat stat, embF32 minValue, embF32 maxValue, std::span<embU32> buckets) const noexcept
+{
+    std::fill(buckets.begin(), buckets.end(), 0u);
+    if (buckets.empty() || maxValue <= minValue)
+        return 0;
+
+    embFixedSizeArray<embF32, CLOCKSTATS_WINDOW_SIZE> samples;
+    const embU32 sampleCount = CopyWindow(stat, samples);
+
+    const embF32 bucketScale = (embF32)buckets.size() / (maxValue - minValue);
+    const embS64 lastBucket = (embS64)buckets.size() - 1;
+    for (embU32 i = 0; i < sampleCount; i++)
+    {
+        const embS64 bucket = (embS64)((samples[i] - minValue) * bucketScale);
+        buckets[(embSizeT)std::clamp<embS64>(bucket, 0, lastBucket)]++;
+    }
+
+    return sampleCount;
+}
+
+EMB_NAMESPACE_END
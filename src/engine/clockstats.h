@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <span>
+
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Values tracked per frame by ClockStats.
+enum class ClockStat : embU8
+{
+    FRAME_TIME, // ms between frames (DT)
+    FIXED_TICKS, // fixed ticks run this frame
+    SKIPPED_TICKS, // fixed ticks dropped this frame
+    INTERP_AMOUNT, // fixed update interp amount this frame, 0-1
+    SLEEP_TIME, // ms slept waiting for this frame
+    SPIN_TIME, // ms spun waiting for this frame
+    IDLE_WORK_TIME, // ms of idle tasks run while waiting for this frame
+    FRAME_MEMORY, // KB of FrameArena memory used by the last frame
+    ENUM_COUNT
+};
+
+// Number of frames kept per stat. Power of two so the ring index is a mask.
+constexpr embU32 CLOCKSTATS_WINDOW_SIZE = 256;
+EMB_ASSERT_STATIC((CLOCKSTATS_WINDOW_SIZE & (CLOCKSTATS_WINDOW_SIZE - 1)) == 0, "CLOCKSTATS_WINDOW_SIZE must be a power of two");
+
+struct ClockStatSummary
+{
+    embF32 p50 = 0.f;
+    embF32 p95 = 0.f;
+    embF32 p99 = 0.f;
+    embF32 max = 0.f;
+    embF32 mean = 0.f;
+    embU32 sampleCount = 0; // number of frames the summary was computed from
+};
+
+// Rolling window of per-frame clock stats. Fixed memory, nothing is allocated after construction.
+// One writer (the thread running EngineClock::ShouldUpdate), any number of readers on any thread.
+// Readers never block the writer. A reader racing the writer may see a mix of the newest and oldest frame
+// in a slot, which is fine for stats.
+class ClockStats
+{
+  public:
+    // Writer only. Records one value for the frame currently being built.
+    void Record(ClockStat stat, embF32 value) noexcept;
+    // Writer only. Publishes the frame built by Record calls and moves on to the next slot.
+    void CommitFrame() noexcept;
+    // Writer only. Drops all recorded frames.
+    void Reset() noexcept;
+
+    // Total number of frames committed since the last reset.
+    embU64 GetFrameCount() const noexcept;
+    // Most recently committed value of a stat.
+    embF32 GetLatest(ClockStat stat) const noexcept;
+    // Percentiles/max/mean over the window.
+    ClockStatSummary GetSummary(ClockStat stat) const noexcept;
+    // Counts samples in the window into buckets evenly spaced between minValue and maxValue.
+    // Samples outside the range land in the first/last bucket. Returns the number of samples counted.
+    embU32 GetHistogram(ClockStat stat, embF32 minValue, embF32 maxValue, std::span<embU32> buckets) const noexcept;
+
+  private:
+    // Copies the window of a stat into out, returns the number of samples copied.
+    embU32 CopyWindow(ClockStat stat, embFixedSizeArray<embF32, CLOCKSTATS_WINDOW_SIZE>& out) const noexcept;
+
+    using StatWindow = embFixedSizeArray<std::atomic<embF32>, CLOCKSTATS_WINDOW_SIZE>;
+    embFixedSizeArray<StatWindow, (embSizeT)ClockStat::ENUM_COUNT> m_Windows {};
+
+    std::atomic<embU64> m_FrameCount = 0; // frames committed. Slot being built is m_FrameCount & mask.
+};
+
+EMB_NAMESPACE_END
@@ -4,25 +4,143 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "util/macros.h"
+#include "util/macros_debug.h"
 
 #include "engine.h"
+#include "framearena.h"
+#include "framegraph.h"
 #include "graphics.h"
+#include "initgraph.h"
+#include "jobsystem.h"
+#include "mainthreadqueue.h"
+#include "scheduler.h"
+#include "services.h"
+#include "simthread.h"
+#include "task.h"
+#include "threadmanager.h"
+#include "timerwheel.h"
 #include "util/types.h"
 #include "window.h"
 
 EMB_NAMESPACE_START
 
+// Wakes the loop this often while nothing in the background needs frames, to keep idle tasks going.
+constexpr embU32 BACKGROUND_IDLE_FRAMERATE = 4;
+
+static BackgroundState QueryWindowBackgroundState() noexcept
+{
+    if (Engine::Instance().IsHeadless())
+        return BackgroundState::FOREGROUND;
+
+    const WindowManager& window = WindowManager::Instance();
+    if (window.IsWindowIconified())
+        return BackgroundState::ICONIFIED;
+    if (!window.IsWindowFocused())
+        return BackgroundState::UNFOCUSED;
+    return BackgroundState::FOREGROUND;
+}
+
+// EngineClock frame wait while in the background: block on window events instead of sleeping/spinning.
+static embBool WaitForWindowEvents(EngineClock::ClockDurationType timeout, void* userData)
+{
+    WindowManager::Instance().WaitInputEvents((embF64)timeout / (embF64)EngineClock::Clock::period::den);
+
+    // cut the wait short when the window state changes, so coming back to the foreground is instant.
+    const Engine& engine = *(const Engine*)userData;
+    return QueryWindowBackgroundState() != engine.GetBackgroundState();
+}
+
+void Engine::CreateServices(ServiceRegistry& services) noexcept
+{
+    ServiceRegistry::SetCurrent(&services);
+
+    // Order matters for teardown: a service may use the ones created before it in its destructor.
+    services.Create<ThreadManager>();
+    services.Create<FrameArena>(); // outlives everything that may hold frame memory
+    services.Create<JobSystem>();
+    services.Create<MainThreadQueue>();
+    services.Create<TaskScheduler>();
+    services.Create<EngineClock>();
+    services.Create<SimulationThread>();
+    services.Create<TimerWheel>();
+    services.Create<SystemScheduler>();
+    services.Create<FrameTaskGraph>();
+    services.Create<ResourceManager>();
+    services.Create<WindowManager>();
+    services.Create<Graphics>();
+    services.Create<Engine>();
+}
+
 void Engine::Init()
 {
     m_IsEngineRunning = true;
 
-    // init all managers
-    // TODO: Probably make them all inherit IManager class and then do a loop to init.
-    WindowManager::Instance().Init();
-    Graphics::Instance().Init();
+    ThreadManager::Instance().ApplyToCurrentThread(ThreadRole::MAIN);
+    JobSystem::Instance().Init(); // first, everything else may want to use it
 
-    // Rest of Engine init logic here
+    // init all managers. Steps run as soon as what they depend on is done, independent ones in parallel.
+    InitGraph initGraph;
+    if (!m_IsHeadless)
+    {
+        InitStepDesc windowStep;
+        windowStep.name = "WindowManager::Init";
+        windowStep.func = [](void*) { WindowManager::Instance().Init(); };
+        windowStep.isMainThreadOnly = true; // GLFW wants the main thread
+        initGraph.AddStep(windowStep);
+
+        Graphics::Instance().AddInitSteps(initGraph);
+    }
+
+    InitStepDesc resourceStep;
+    resourceStep.name = "Engine::InitResources";
+    resourceStep.func = [](void*) { Engine::Instance().InitResources(); };
+    initGraph.AddStep(resourceStep);
+
+    initGraph.Run();
+    initGraph.PrintTimings();
+
+    if (!m_IsHeadless)
+    {
+        // GL context lives on the main thread.
+        FrameTaskDesc renderTask;
+        renderTask.name = "Graphics::Render";
+        renderTask.func = [](void*) { Graphics::Instance().Render(); }; // do i need this layer lmao
+        renderTask.phase = FramePhase::RENDER;
+        renderTask.isMainThreadOnly = true;
+        renderTask.Writes<Graphics>();
+        FrameTaskGraph::Instance().AddTask(renderTask);
+    }
+
+    // Post-init stuff
+    if (m_IsHeadless)
+    {
+        // sim thread paces itself against wall-clock time, which would break determinism.
+        if (EngineClock::Instance().IsSimulationThreaded())
+        {
+            printf("Warning: Threaded simulation is not supported while headless, running fixed updates on main thread\n");
+            EngineClock::Instance().SetSimulationThreaded(false);
+        }
+        m_HeadlessClockSource.SetTime(0);
+        EngineClock::Instance().SetClockSource(&m_HeadlessClockSource); // also resets the timer
+    }
+
+    EngineClock::Instance()
+        .ResetTimer(); // avoid the "skipping tick" warning due to long startup
+
+    // threaded before Init. Switching later on is handled by EngineClock::SetSimulationThreaded.
+    if (EngineClock::Instance().IsSimulationThreaded())
+    {
+        UpdateSimThreadActive();
+        SimulationThread::Instance().Start();
+    }
+}
+
+void Engine::InitResources()
+{
     // Registering RESOURCE stuffs.
 
     ResourceHandle test = ResourceManager::Instance().GetResourceHandle(ResourceType::SCENE, 1234);
@@ -31,31 +149,97 @@ void Engine::Init()
         ResourceHandle test3 = ResourceManager::Instance().GetResourceHandle(ResourceType::SCENE, 1234);
     }
 
-    printf("pointer is %u\n", (embU64)test.GetData()); // prints 1234
+    printf("pointer is %p\n", test.GetData()); // address of the pooled record
 
     const char* hehe = "new embStr";
     ResourceManager::Instance().LoadResourceExternal(ResourceType::SHADER_FRAG, 12'345, (embGenericPtr)hehe);
 
     ResourceHandle test4 = ResourceManager::Instance().GetResourceHandle(ResourceType::SHADER_FRAG, 12'345);
-
-    // Post-init stuff
-    EngineClock::Instance()
-        .ResetTimer(); // avoid the "skipping tick" warning due to long startup
 }
 
 void Engine::Update()
 {
+    UpdateBackgroundState();
+    TaskScheduler::Instance().RunFrame(); // tasks waiting on NextFrame or a JobCounter
+    FrameTaskGraph::Instance().Execute(FramePhase::UPDATE);
+
+    // GL/GLFW work posted by other threads, done before Render so uploads land this frame.
+    MainThreadQueue::Instance().Drain(MainThreadQueue::Instance().GetFrameBudget());
+}
+
+void Engine::FixedUpdate()
+{
+    // On the main thread, report how long the tick took so the clock can govern sim overload.
+    const embBool reportCost = !EngineClock::Instance().IsSimulationThreaded();
+    const EngineClock::ClockTimePoint tickStart = reportCost ? EngineClock::Clock::now() : EngineClock::ClockTimePoint {};
+
+    // fixed-rate game logic goes here
+    TimerWheel::Instance().Tick();
+    TaskScheduler::Instance().RunFixedTick();
+    SystemScheduler::Instance().Tick();
+
+    // a threaded sim publishes this once the tick is done (SimulationThread).
+    m_PreviousSimState = m_SimState;
+    m_SimState.tickIndex++;
+    m_SimState.simTime += EngineClock::Instance().GetFixedDT();
+
+    if (reportCost)
+        EngineClock::Instance().RecordFixedUpdateCost((EngineClock::Clock::now() - tickStart).count());
 }
 
 void Engine::Render()
 {
-    Graphics::Instance().Render(); // do i need this layer lmao
+    if (m_IsHeadless)
+        return;
+
+    // Background: skip frames that the render policy doesn't want, but keep input flowing.
+    const BackgroundSettings& background = m_BackgroundSettings[(embSizeT)m_BackgroundState];
+    const embF32 realTime = EngineClock::Instance().GetRealTimeElapsed();
+    embBool shouldRender = background.renderPolicy == BackgroundRenderPolicy::FULL_RATE;
+    if (background.renderPolicy == BackgroundRenderPolicy::THROTTLE && background.throttledFramerate > 0)
+    {
+        // half a frame of slack, frames landing just short of the interval would otherwise skip a whole extra frame.
+        const embF32 renderInterval = 1.f / (embF32)background.throttledFramerate;
+        shouldRender = realTime - m_LastRenderTime + 0.5f * EngineClock::Instance().GetTargetFrameTime() >= renderInterval;
+    }
+
+    if (!shouldRender)
+    {
+        WindowManager::Instance().PollInputEvents();
+        return;
+    }
+
+    m_LastRenderTime = realTime;
+
+    // draw between the last two ticks. A threaded sim hands them over through its snapshot buffer.
+    EngineClock& clock = EngineClock::Instance();
+    if (clock.IsSimulationThreaded())
+    {
+        const SimulationThread::StateSnapshot& snapshot = SimulationThread::Instance().AcquireLatestState();
+        m_RenderSimState = InterpolateSimState(snapshot.previous, snapshot.current, clock.GetFixedUpdateInterpAmount());
+    }
+    else
+        m_RenderSimState = InterpolateSimState(m_PreviousSimState, m_SimState, clock.GetFixedUpdateInterpAmount());
+
+    FrameTaskGraph::Instance().Execute(FramePhase::RENDER);
 }
 
 void Engine::Destroy() noexcept
 {
-    Graphics::Instance().Destroy();
-    WindowManager::Instance().Destroy();
+    SimulationThread::Instance().Stop(); // no-op if sim is not threaded
+    EngineClock::Instance().SetFrameWaitFunc(nullptr, nullptr);
+
+    // jobs may still post main thread commands, finish them first and run what they posted while GL is still up.
+    JobSystem::Instance().Destroy();
+    MainThreadQueue::Instance().DrainAll();
+
+    if (m_IsHeadless)
+        EngineClock::Instance().SetClockSource(nullptr); // back to wall-clock time
+    else
+    {
+        Graphics::Instance().Destroy();
+        WindowManager::Instance().Destroy();
+    }
 }
 
 bool Engine::IsEngineRunning() const noexcept
@@ -71,6 +255,39 @@ bool Engine::IsSimulationActive() const noexcept
 void Engine::SetSimulationActive(embBool active) noexcept
 {
     m_IsSimulationActive = active;
+    UpdateSimThreadActive();
+}
+
+bool Engine::IsSimulationPaused() const noexcept
+{
+    return m_IsSimulationPaused;
+}
+
+void Engine::SetSimulationPaused(embBool paused) noexcept
+{
+    m_IsSimulationPaused = paused;
+    UpdateSimThreadActive();
+}
+
+bool Engine::IsSimulationRunning() const noexcept
+{
+    return m_IsSimulationActive && !m_IsSimulationPaused && !m_IsBackgroundPaused;
+}
+
+const SimState& Engine::GetSimState() const noexcept
+{
+    EMB_ASSERT_HARD(SimulationThread::Instance().IsFixedUpdateThread(), "sim state belongs to the sim thread while threaded");
+    return m_SimState;
+}
+
+const SimState& Engine::GetRenderSimState() const noexcept
+{
+    return m_RenderSimState;
+}
+
+void Engine::UpdateSimThreadActive() noexcept
+{
+    SimulationThread::Instance().SetActive(IsSimulationRunning());
 }
 
 void Engine::SignalEngineStop()
@@ -78,4 +295,77 @@ void Engine::SignalEngineStop()
     m_IsEngineRunning = false;
 }
 
+void Engine::SetHeadless(embBool headless) noexcept
+{
+    EMB_ASSERT_HARD(!m_IsEngineRunning, "SetHeadless must be called before Init");
+    m_IsHeadless = headless;
+}
+
+bool Engine::IsHeadless() const noexcept
+{
+    return m_IsHeadless;
+}
+
+void Engine::SetBackgroundSettings(BackgroundState state, const BackgroundSettings& settings) noexcept
+{
+    EMB_ASSERT_HARD(state != BackgroundState::FOREGROUND, "foreground always renders and simulates at full rate");
+    m_BackgroundSettings[(embSizeT)state] = settings;
+
+    // re-apply if currently in that state.
+    if (state == m_BackgroundState)
+        ApplyBackgroundState(state);
+}
+
+const BackgroundSettings& Engine::GetBackgroundSettings(BackgroundState state) const noexcept
+{
+    return m_BackgroundSettings[(embSizeT)state];
+}
+
+BackgroundState Engine::GetBackgroundState() const noexcept
+{
+    return m_BackgroundState;
+}
+
+void Engine::UpdateBackgroundState() noexcept
+{
+    const BackgroundState state = QueryWindowBackgroundState();
+    if (state != m_BackgroundState)
+        ApplyBackgroundState(state);
+}
+
+void Engine::ApplyBackgroundState(BackgroundState state) noexcept
+{
+    EngineClock& clock = EngineClock::Instance();
+
+    // remember the real framerate on the way out of the foreground.
+    if (m_BackgroundState == BackgroundState::FOREGROUND)
+        m_ForegroundFramerate = (embU32)std::lround(clock.GetTargetFramerate());
+
+    m_BackgroundState = state;
+    const BackgroundSettings& settings = m_BackgroundSettings[(embSizeT)state];
+
+    m_IsBackgroundPaused = settings.simPolicy == BackgroundSimPolicy::PAUSE;
+    UpdateSimThreadActive();
+
+    if (state == BackgroundState::FOREGROUND)
+    {
+        clock.SetTargetFramerate(m_ForegroundFramerate);
+        clock.SetFrameWaitFunc(nullptr, nullptr);
+        return;
+    }
+
+    embU32 framerate = BACKGROUND_IDLE_FRAMERATE;
+    if (settings.renderPolicy == BackgroundRenderPolicy::FULL_RATE)
+        framerate = m_ForegroundFramerate;
+    else if (settings.renderPolicy == BackgroundRenderPolicy::THROTTLE)
+        framerate = std::max(settings.throttledFramerate, 1u);
+
+    // Fixed ticks only run on frames, keep enough frames for the sim to hold its rate (render skips the extra ones).
+    if (!m_IsBackgroundPaused && !clock.IsSimulationThreaded())
+        framerate = std::max(framerate, (embU32)std::ceil(clock.GetTargetSimRate()));
+
+    clock.SetTargetFramerate(std::min(framerate, m_ForegroundFramerate));
+    clock.SetFrameWaitFunc(WaitForWindowEvents, this);
+}
+
 EMB_NAMESPACE_END
@@ -1,14 +1,55 @@
 #pragma once
 
+#include "engine/engineclock.h"
+#include "engine/services.h"
+#include "engine/simthread.h"
+#include "util/containers.h"
 #include "util/macros.h"
 #include "util/types.h"
 
 EMB_NAMESPACE_START
 
+// Where the window stands, from the engine's point of view. Headless is always FOREGROUND.
+enum class BackgroundState : embU8
+{
+    FOREGROUND,
+    UNFOCUSED, // visible, but another window has focus
+    ICONIFIED, // minimized
+    ENUM_COUNT
+};
+
+// What rendering does while in the background.
+enum class BackgroundRenderPolicy : embU8
+{
+    FULL_RATE, // keep rendering at the target framerate
+    THROTTLE, // render at BackgroundSettings::throttledFramerate
+    STOP, // don't render at all
+    ENUM_COUNT
+};
+
+// What the sim does while in the background.
+enum class BackgroundSimPolicy : embU8
+{
+    KEEP_RATE, // keep running fixed ticks at the target sim rate
+    PAUSE, // stop sim time until back in the foreground
+    ENUM_COUNT
+};
+
+struct BackgroundSettings
+{
+    BackgroundRenderPolicy renderPolicy = BackgroundRenderPolicy::THROTTLE;
+    embU32 throttledFramerate = 10;
+    BackgroundSimPolicy simPolicy = BackgroundSimPolicy::KEEP_RATE;
+};
+
 class Engine
 {
   public:
-    EMB_CLASS_SINGLETON_MACRO(Engine)
+    EMB_CLASS_SERVICE_MACRO(Engine, ENGINE)
+
+    // Creates every engine service in services, in dependency order, and binds it to the calling thread.
+    // Run once per engine instance before Init. The services are torn down in reverse by services.DestroyAll.
+    static void CreateServices(ServiceRegistry& services) noexcept;
 
     // Initializes engine. Run once.
     void Init();
@@ -16,6 +57,9 @@ class Engine
     // Run once to update game logic once. Possible to block due to framerate cap.
     void Update();
 
+    // Run ShouldFixedUpdate times per Update. Runs on the SimulationThread instead if the sim is threaded.
+    void FixedUpdate();
+
     // Run right after Update. Depends on the framerate controller in Update.
     void Render();
 
@@ -39,13 +83,59 @@ class Engine
     // Sets simulation to run or suspend.
     void SetSimulationPaused(embBool active) noexcept;
 
+    // Active, not paused, and not paused by the background policy. What to pass to EngineClock::ShouldUpdate.
+    bool IsSimulationRunning() const noexcept;
+
+    // Thread running fixed updates only. State after the last fixed tick.
+    const SimState& GetSimState() const noexcept;
+    // Main thread only. Sim state for this frame's render, interpolated between the last two ticks by Render.
+    // With a threaded sim, this is the only sim state the main thread may read.
+    const SimState& GetRenderSimState() const noexcept;
+
     // tells engine to stop running after this frame.
     void SignalEngineStop();
 
+    // Headless: no window or graphics, and EngineClock runs on virtual time so frames and fixed ticks
+    // run back to back as fast as the CPU allows. Tick-for-tick deterministic. Set before Init.
+    void SetHeadless(embBool headless) noexcept;
+    bool IsHeadless() const noexcept;
+
+    // Power/perf mode for when the window is unfocused or minimized. Rendering gets throttled or stopped, the sim keeps
+    // its rate or pauses, and the main loop blocks on window events instead of sleeping/spinning.
+    // The foreground framerate is whatever EngineClock's target framerate was when the window went into the background.
+    void SetBackgroundSettings(BackgroundState state, const BackgroundSettings& settings) noexcept;
+    const BackgroundSettings& GetBackgroundSettings(BackgroundState state) const noexcept;
+    BackgroundState GetBackgroundState() const noexcept;
+
   private:
+    // Init step: registers the engine's built-in resources. Only touches ResourceManager, runs on any thread.
+    void InitResources();
+
+    // Switches background modes when the window state changed. Run at the start of every Update.
+    void UpdateBackgroundState() noexcept;
+    void ApplyBackgroundState(BackgroundState state) noexcept;
+    void UpdateSimThreadActive() noexcept;
+
     embBool m_IsEngineRunning = false;
     embBool m_IsSimulationActive = false;
     embBool m_IsSimulationPaused = false;
+    embBool m_IsHeadless = false;
+
+    VirtualClockSource m_HeadlessClockSource; // drives EngineClock while headless
+
+    SimState m_SimState; // thread running fixed updates only
+    SimState m_PreviousSimState; // thread running fixed updates only
+    SimState m_RenderSimState; // main thread only
+
+    BackgroundState m_BackgroundState = BackgroundState::FOREGROUND;
+    embFixedSizeArray<BackgroundSettings, (embSizeT)BackgroundState::ENUM_COUNT> m_BackgroundSettings {
+        BackgroundSettings {BackgroundRenderPolicy::FULL_RATE, 0, BackgroundSimPolicy::KEEP_RATE}, // FOREGROUND, fixed
+        BackgroundSettings {BackgroundRenderPolicy::THROTTLE, 30, BackgroundSimPolicy::KEEP_RATE}, // UNFOCUSED
+        BackgroundSettings {BackgroundRenderPolicy::STOP, 0, BackgroundSimPolicy::KEEP_RATE}, // ICONIFIED
+    };
+    embBool m_IsBackgroundPaused = false; // sim paused by the background policy
+    embU32 m_ForegroundFramerate = 0; // target framerate to restore when back in the foreground
+    embF32 m_LastRenderTime = 0.f; // real time of the last rendered frame, for throttling
 };
 
 EMB_NAMESPACE_END
@@ -1,12 +1,95 @@
+#include "engine.h"
 #include "engineclock.h"
+#include "framearena.h"
+#include "simthread.h"
+#include "util/macros_debug.h"
+#include "util/memtracker.h"
 #include "util/types.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <ctime>
+#include <thread>
 
 EMB_NAMESPACE_START
 
+// Requested length of a single sleep. Short slices keep the overshoot small and give the estimator lots of samples.
+constexpr std::chrono::microseconds PACING_SLEEP_SLICE {1000};
+// Weight of each new sample in the sleep estimate. Lower = smoother, but slower to react to OS scheduler changes.
+constexpr embF64 PACING_ESTIMATE_WEIGHT = 1.0 / 64.0;
+
+// Overload governor thresholds, as a fraction of real time spent running fixed ticks.
+constexpr embF64 GOVERNOR_LOAD_HIGH = 0.75; // above this, the sim is considered overloaded
+constexpr embF64 GOVERNOR_LOAD_LOW = 0.5; // below this (at the next higher rate), the sim is considered recovered
+constexpr embU32 GOVERNOR_OVERLOAD_FRAMES = 30; // frames of sustained overload before downrating
+constexpr embU32 GOVERNOR_RECOVER_FRAMES = 120; // frames of sustained recovery before going back up a rate
+constexpr embF64 GOVERNOR_COST_WEIGHT = 1.0 / 16.0; // weight of each new sample in the tick cost average
+
+//-------------------------------------------------------------------//
+//                            ClockSource                            //
+//-------------------------------------------------------------------//
+
+EngineClock::ClockDurationType SystemClockSource::Now() const noexcept
+{
+    return EngineClock::Clock::now().time_since_epoch().count();
+}
+
+void SystemClockSource::SleepFor(EngineClock::ClockDurationType duration) noexcept
+{
+    std::this_thread::sleep_for(EngineClock::ClockDuration(duration));
+}
+
+embBool SystemClockSource::IsRealTime() const noexcept
+{
+    return true;
+}
+
+EngineClock::ClockDurationType VirtualClockSource::Now() const noexcept
+{
+    return m_Now;
+}
+
+void VirtualClockSource::SleepFor(EngineClock::ClockDurationType duration) noexcept
+{
+    Advance(duration);
+}
+
+embBool VirtualClockSource::IsRealTime() const noexcept
+{
+    return false;
+}
+
+void VirtualClockSource::Advance(EngineClock::ClockDurationType duration) noexcept
+{
+    if (duration > 0)
+        m_Now += duration;
+}
+
+void VirtualClockSource::SetTime(EngineClock::ClockDurationType timeEpoch) noexcept
+{
+    m_Now = timeEpoch;
+}
+
+static SystemClockSource& GetSystemClockSource() noexcept
+{
+    static SystemClockSource systemClockSource;
+    return systemClockSource;
+}
+
+//-------------------------------------------------------------------//
+//                            EngineClock                            //
+//-------------------------------------------------------------------//
+
 EngineClock::EngineClock() noexcept
 {
+    m_ClockSource = &GetSystemClockSource();
+
+    // Start off pessimistic (1.25x slice mean, 0.25x slice stddev) and let the estimator pull it down.
+    const embF64 slice = (embF64)std::chrono::duration_cast<ClockDuration>(PACING_SLEEP_SLICE).count();
+    m_SleepMean = slice * 1.25;
+    m_SleepVariance = (slice * 0.25) * (slice * 0.25);
+    m_SleepEstimate = (ClockDurationType)(m_SleepMean + std::sqrt(m_SleepVariance));
+
     ResetTimer();
 }
 
@@ -30,6 +113,9 @@ void EngineClock::SetTargetSimRate(embU32 targetTPS) noexcept
         return;
 
     m_TargetSimTime = ClockDuration(Clock::period::den / targetTPS).count();
+
+    if (m_IsSimThreaded)
+        SimulationThread::Instance().SetTickPeriod(m_TargetSimTime);
 }
 
 embF32 EngineClock::GetTargetFramerate() const noexcept
@@ -39,6 +125,9 @@ embF32 EngineClock::GetTargetFramerate() const noexcept
 
 embF32 EngineClock::GetTargetSimRate() const noexcept
 {
+    // the sim thread reads this, stick to the period handed to it instead of what the main thread may be changing.
+    if (m_IsSimThreaded)
+        return (embF32)Clock::period::den / (embF32)SimulationThread::Instance().GetTickPeriod();
     return (embF32)Clock::period::den / (embF32)m_TargetSimTime;
 }
 
@@ -57,7 +146,9 @@ embF32 EngineClock::GetDT() const noexcept
 }
 embF32 EngineClock::GetFixedDT() const noexcept
 {
-    return (embF32)m_TargetSimTime / (embF32)Clock::period::den;
+    if (m_IsSimThreaded)
+        return (embF32)SimulationThread::Instance().GetTickPeriod() / (embF32)Clock::period::den;
+    return (embF32)GetEffectiveSimTime() / (embF32)Clock::period::den;
 }
 
 embF32 EngineClock::GetRealTimeElapsed() const noexcept
@@ -76,12 +167,300 @@ void EngineClock::SetSimTimeScale(embF32 timeScale) noexcept
         return;
 
     m_TimeScale = timeScale;
+
+    if (m_IsSimThreaded)
+        SimulationThread::Instance().SetTimeScale(m_TimeScale);
 }
 embF32 EngineClock::GetSimTimeScale() const noexcept
 {
     return m_TimeScale;
 }
 
+void EngineClock::SetSimulationThreaded(embBool threaded) noexcept
+{
+    if (threaded == m_IsSimThreaded)
+        return;
+
+    const Engine& engine = Engine::Instance();
+    SimulationThread& simThread = SimulationThread::Instance();
+    if (threaded && engine.IsEngineRunning() && engine.IsHeadless())
+    {
+        printf("Warning: Threaded simulation is not supported while headless, keeping fixed updates on main thread\n");
+        return;
+    }
+
+    // the sim thread must be done with its last tick before the main thread takes fixed updates back.
+    if (!threaded)
+        simThread.Stop(); // no-op if it never started
+
+    m_IsSimThreaded = threaded;
+    m_SimStepCount = 0;
+
+    if (!threaded)
+    {
+        // sim time kept running while threaded, pick the cadence up from here instead of catching up on all of it.
+        m_LastFixedUpdateTime = m_SimTimeElapsed;
+        return;
+    }
+
+    simThread.SetTickPeriod(m_TargetSimTime);
+    simThread.SetTimeScale(m_TimeScale);
+
+    // before Init, Engine::Init starts it.
+    if (engine.IsEngineRunning())
+    {
+        simThread.SetActive(engine.IsSimulationRunning());
+        simThread.Start();
+    }
+}
+
+embBool EngineClock::IsSimulationThreaded() const noexcept
+{
+    return m_IsSimThreaded;
+}
+
+void EngineClock::SetFramePacingMode(FramePacingMode mode) noexcept
+{
+    m_PacingMode = mode;
+    m_IsSpinWaiting = false;
+}
+
+FramePacingMode EngineClock::GetFramePacingMode() const noexcept
+{
+    return m_PacingMode;
+}
+
+embU32 EngineClock::GetLastFrameSleepMicros() const noexcept
+{
+    return (embU32)std::chrono::duration_cast<std::chrono::microseconds>(ClockDuration(m_LastFrameSleepTime)).count();
+}
+
+embU32 EngineClock::GetLastFrameSpinMicros() const noexcept
+{
+    return (embU32)std::chrono::duration_cast<std::chrono::microseconds>(ClockDuration(m_LastFrameSpinTime)).count();
+}
+
+embU32 EngineClock::GetLastFrameIdleWorkMicros() const noexcept
+{
+    return (embU32)std::chrono::duration_cast<std::chrono::microseconds>(ClockDuration(m_LastFrameIdleWorkTime)).count();
+}
+
+embU32 EngineClock::GetSleepEstimateMicros() const noexcept
+{
+    return (embU32)std::chrono::duration_cast<std::chrono::microseconds>(ClockDuration(m_SleepEstimate)).count();
+}
+
+void EngineClock::SetSimCatchUpPolicy(SimCatchUpPolicy policy) noexcept
+{
+    m_CatchUpPolicy = policy;
+    m_ActiveCatchUpPolicy = policy == SimCatchUpPolicy::AUTO ? SimCatchUpPolicy::SPREAD : policy;
+    m_OverloadedFrames = 0;
+    m_RecoveredFrames = 0;
+
+    if (policy == SimCatchUpPolicy::CLAMP || policy == SimCatchUpPolicy::SPREAD)
+        m_SimRateDivisor = 1;
+}
+
+SimCatchUpPolicy EngineClock::GetSimCatchUpPolicy() const noexcept
+{
+    return m_CatchUpPolicy;
+}
+
+SimCatchUpPolicy EngineClock::GetActiveSimCatchUpPolicy() const noexcept
+{
+    return m_ActiveCatchUpPolicy;
+}
+
+void EngineClock::SetSimCatchUpSettings(const SimCatchUpSettings& settings) noexcept
+{
+    m_CatchUpSettings = settings;
+    m_CatchUpSettings.maxStepsPerFrame = std::max(m_CatchUpSettings.maxStepsPerFrame, 1u);
+    m_CatchUpSettings.maxRateDivisor = std::max(m_CatchUpSettings.maxRateDivisor, 1u);
+    m_SimRateDivisor = std::min(m_SimRateDivisor, m_CatchUpSettings.maxRateDivisor);
+}
+
+const SimCatchUpSettings& EngineClock::GetSimCatchUpSettings() const noexcept
+{
+    return m_CatchUpSettings;
+}
+
+void EngineClock::RecordFixedUpdateCost(ClockDurationType cost) noexcept
+{
+    if (m_TickCostAvg == 0.0)
+        m_TickCostAvg = (embF64)cost;
+    else
+        m_TickCostAvg += GOVERNOR_COST_WEIGHT * ((embF64)cost - m_TickCostAvg);
+}
+
+embF32 EngineClock::GetSimLoad() const noexcept
+{
+    // ticks needed per real second * cost of each tick
+    return (embF32)(m_TickCostAvg * (embF64)m_TimeScale / (embF64)GetEffectiveSimTime());
+}
+
+embU32 EngineClock::GetSimRateDivisor() const noexcept
+{
+    return m_SimRateDivisor;
+}
+
+embU32 EngineClock::GetSimTickDebt() const noexcept
+{
+    if (m_SimTimeElapsed < m_LastFixedUpdateTime)
+        return 0;
+    return (embU32)((m_SimTimeElapsed - m_LastFixedUpdateTime) / GetEffectiveSimTime());
+}
+
+embU32 EngineClock::GetLastFrameSkippedTicks() const noexcept
+{
+    return m_LastFrameSkippedTicks;
+}
+
+EngineClock::ClockDurationType EngineClock::GetEffectiveSimTime() const noexcept
+{
+    return m_TargetSimTime * m_SimRateDivisor;
+}
+
+void EngineClock::UpdateOverloadGovernor() noexcept
+{
+    if (m_CatchUpPolicy != SimCatchUpPolicy::DOWNRATE && m_CatchUpPolicy != SimCatchUpPolicy::AUTO)
+        return;
+
+    // tick cost is real time, but virtual time isn't. Comparing them would make the sim rate depend on the machine.
+    if (!m_ClockSource->IsRealTime())
+        return;
+
+    // load at the current rate, and what it would be one rate step higher.
+    const embF64 load = GetSimLoad();
+    const embF64 loadOneRateUp = m_SimRateDivisor > 1 ? load * m_SimRateDivisor / (m_SimRateDivisor - 1) : load;
+
+    m_OverloadedFrames = load > GOVERNOR_LOAD_HIGH ? m_OverloadedFrames + 1 : 0;
+    m_RecoveredFrames = (m_SimRateDivisor > 1 && loadOneRateUp < GOVERNOR_LOAD_LOW) ? m_RecoveredFrames + 1 : 0;
+
+    if (m_OverloadedFrames >= GOVERNOR_OVERLOAD_FRAMES && m_SimRateDivisor < m_CatchUpSettings.maxRateDivisor)
+    {
+        m_SimRateDivisor++;
+        m_OverloadedFrames = 0;
+        printf("Warning: Sim overloaded (load %.2f), dropping sim rate to %.1f ticks/s\n",
+               load, GetTargetSimRate() / (embF32)m_SimRateDivisor);
+    }
+    else if (m_RecoveredFrames >= GOVERNOR_RECOVER_FRAMES)
+    {
+        m_SimRateDivisor--;
+        m_RecoveredFrames = 0;
+        printf("Sim recovered, raising sim rate to %.1f ticks/s\n", GetTargetSimRate() / (embF32)m_SimRateDivisor);
+    }
+
+    // AUTO: carry debt over while the sim keeps up, downrate while it does not.
+    if (m_CatchUpPolicy == SimCatchUpPolicy::AUTO)
+    {
+        const embBool isOverloaded = m_SimRateDivisor > 1 || m_OverloadedFrames > 0;
+        m_ActiveCatchUpPolicy = isOverloaded ? SimCatchUpPolicy::DOWNRATE : SimCatchUpPolicy::SPREAD;
+    }
+}
+
+embU32 EngineClock::ApplySimCatchUpPolicy(embU32 dueSteps) noexcept
+{
+    const embU32 maxSteps = m_CatchUpSettings.maxStepsPerFrame;
+    if (dueSteps <= maxSteps)
+        return dueSteps;
+
+    // SPREAD: leave sim time where it is, the leftover ticks become due again next frame.
+    // Only drop what goes past the allowed debt.
+    embU32 keptSteps = maxSteps;
+    if (m_ActiveCatchUpPolicy == SimCatchUpPolicy::SPREAD)
+    {
+        keptSteps = maxSteps + m_CatchUpSettings.maxTickDebt;
+        if (dueSteps <= keptSteps)
+            return maxSteps;
+    }
+
+    const ClockDurationType simTime = GetEffectiveSimTime();
+    m_LastFrameSkippedTicks = dueSteps - keptSteps;
+    printf("Warning: Skipping %u planned tick(s), rolled back by %ldns (%lf ticks)\n",
+           m_LastFrameSkippedTicks,
+           m_SimTimeElapsed - (m_LastFixedUpdateTime + simTime * keptSteps),
+           (embF64)(m_SimTimeElapsed - (m_LastFixedUpdateTime + simTime * keptSteps)) / (embF64)simTime);
+    // Note: by right, if m_SimTimeElapsed is directly equal to Max Sim time, the engine should
+    // be simulating the next tick, making the engine simulate maxSteps + 1 this frame.
+    // To be pedantic, m_SimTimeElapsed should be set to a little BEFORE the max sim time.
+    // However, we'd want to reduce the time skip as much as possible. Plus, the missing timestep would be triggered the next frame anyway.
+    // Logic may seem inconsistent but this is an edge case and the side effects are not consiquential.
+    m_SimTimeElapsed = m_LastFixedUpdateTime + simTime * keptSteps;
+    return maxSteps;
+}
+
+EngineClock::ClockDurationType EngineClock::WaitUntil(ClockDurationType deadlineEpoch) noexcept
+{
+    // Sleep is cheap but imprecise (the OS wakes us up "some time" after the requested duration),
+    // spinning is precise but burns the core. Sleep in small slices while we are sure the slice + overshoot
+    // still fits before the deadline, then spin out the rest.
+    ClockDurationType now = m_ClockSource->Now();
+
+    // virtual time: nothing to wait for, skip straight to the deadline.
+    if (!m_ClockSource->IsRealTime())
+    {
+        m_ClockSource->SleepFor(deadlineEpoch - now);
+        m_LastFrameSleepTime = 0;
+        m_LastFrameSpinTime = 0;
+        return std::max(deadlineEpoch, m_ClockSource->Now());
+    }
+
+    // Spend the slack on idle tasks first. Stop early enough that the last sleep + spin still lands on the deadline.
+    if (m_IdleTasks.HasTasks())
+    {
+        const ClockDurationType idleStart = now;
+        now = m_IdleTasks.RunUntil(deadlineEpoch - m_SleepEstimate, *m_ClockSource);
+        m_IdleWorkTimeAccum += now - idleStart;
+    }
+
+    // Nothing needs a precise frame here, block until the deadline or until the wait gets cut short.
+    if (m_FrameWaitFunc != nullptr)
+    {
+        const ClockDurationType waitStart = now;
+        while (now < deadlineEpoch)
+        {
+            const embBool stopWaiting = m_FrameWaitFunc(deadlineEpoch - now, m_FrameWaitUserData);
+            now = m_ClockSource->Now();
+            if (stopWaiting)
+                break;
+        }
+
+        m_LastFrameSleepTime = now - waitStart;
+        m_LastFrameSpinTime = 0;
+        return now;
+    }
+
+    const ClockDurationType sleepStart = now;
+
+    while (deadlineEpoch - now > m_SleepEstimate)
+    {
+        m_ClockSource->SleepFor(std::chrono::duration_cast<ClockDuration>(PACING_SLEEP_SLICE).count());
+        const ClockDurationType afterSleep = m_ClockSource->Now();
+        UpdateSleepEstimate(afterSleep - now);
+        now = afterSleep;
+    }
+
+    const ClockDurationType spinStart = now;
+    while (now < deadlineEpoch)
+    {
+        EMB_CPU_PAUSE();
+        now = m_ClockSource->Now();
+    }
+
+    m_LastFrameSleepTime = spinStart - sleepStart;
+    m_LastFrameSpinTime = now - spinStart;
+    return now;
+}
+
+void EngineClock::UpdateSleepEstimate(ClockDurationType observedSleep) noexcept
+{
+    // Exponentially weighted mean/variance, so the estimate keeps tracking the OS if its timer resolution changes.
+    const embF64 delta = (embF64)observedSleep - m_SleepMean;
+    m_SleepMean += PACING_ESTIMATE_WEIGHT * delta;
+    m_SleepVariance = (1.0 - PACING_ESTIMATE_WEIGHT) * (m_SleepVariance + PACING_ESTIMATE_WEIGHT * delta * delta);
+    m_SleepEstimate = (ClockDurationType)(m_SleepMean + std::sqrt(m_SleepVariance));
+}
+
 embBool EngineClock::ShouldUpdate(embBool simActive) noexcept
 {
     // How work:
@@ -97,15 +476,56 @@ embBool EngineClock::ShouldUpdate(embBool simActive) noexcept
     // If the time taken for each fixed update is too long, the engine will skip some fixed updates to avoid an infinite lag loop.
 
     // calculate frame DT each cpu clock cycle
-    const ClockDurationType currentTimeEpoch = Clock::now().time_since_epoch().count();
+    ClockDurationType currentTimeEpoch = m_ClockSource->Now();
     ClockDurationType currentDT = currentTimeEpoch - m_LastUpdateTimePointEpoch;
 
-    // every cpu cycle check if can render frame or continue waiting.
     if (currentDT < m_TargetFrameTime)
-        return false;
+    {
+        // virtual time never moves by itself, polling it would spin forever.
+        if (m_PacingMode == FramePacingMode::SPIN && m_ClockSource->IsRealTime() && m_FrameWaitFunc == nullptr)
+        {
+            // every cpu cycle check if can render frame or continue waiting.
+            if (!m_IsSpinWaiting)
+            {
+                m_IsSpinWaiting = true;
+                m_SpinWaitStartEpoch = currentTimeEpoch;
+            }
+
+            // poll is going to be wasted anyway, put it towards idle tasks.
+            if (m_IdleTasks.HasTasks())
+            {
+                const ClockDurationType idleEnd = m_IdleTasks.RunUntil(m_LastUpdateTimePointEpoch + m_TargetFrameTime, *m_ClockSource);
+                m_IdleWorkTimeAccum += idleEnd - currentTimeEpoch;
+            }
+            return false;
+        }
+
+        // HYBRID (or virtual time): block here until the frame is due instead of bouncing back to the caller.
+        currentTimeEpoch = WaitUntil(m_LastUpdateTimePointEpoch + m_TargetFrameTime);
+        currentDT = currentTimeEpoch - m_LastUpdateTimePointEpoch;
+    }
+    else if (m_PacingMode == FramePacingMode::HYBRID || m_FrameWaitFunc != nullptr)
+    {
+        // frame was already late, no waiting done.
+        m_LastFrameSleepTime = 0;
+        m_LastFrameSpinTime = 0;
+    }
+
+    m_LastFrameIdleWorkTime = m_IdleWorkTimeAccum;
+    m_IdleWorkTimeAccum = 0;
+
+    if (m_PacingMode == FramePacingMode::SPIN && m_FrameWaitFunc == nullptr)
+    {
+        m_LastFrameSleepTime = 0;
+        m_LastFrameSpinTime = m_IsSpinWaiting ? currentTimeEpoch - m_SpinWaitStartEpoch - m_LastFrameIdleWorkTime : 0;
+        m_IsSpinWaiting = false;
+    }
 
     m_DT = currentDT;
     m_LastUpdateTimePointEpoch = currentTimeEpoch;
+
+    // make sure deferred work still trickles through if frames never leave any slack.
+    m_IdleTasks.RunStarved(*m_ClockSource);
     m_RealTimeElapsed = currentTimeEpoch - m_AppStartTimePoint; // save real time now to keep subsequent calls for real time consistent
 
     // Update simulation time variables
@@ -113,37 +533,34 @@ embBool EngineClock::ShouldUpdate(embBool simActive) noexcept
     //      > Implication: If slow down, lesser steps are taken, making workload lighter. If increase, more steps are taken, increasing workload.
     //      > Speeding up time implies can imply that physics sims can happen multiple times per frame if cranked up too high.
     if (simActive)
-        m_SimTimeElapsed += m_DT * m_TimeScale;
+        m_SimTimeElapsed += (ClockDurationType)((embF64)m_DT * (embF64)m_TimeScale); // f64, f32 drifts over long sessions
 
     // Perform sim if any
     m_SimStepCount = 0; // reset step count for frame
-    constexpr embU32 MAX_SIM_STEPS = 2;
+
+    // sim thread keeps its own cadence, nothing to step here.
+    if (m_IsSimThreaded)
+    {
+        BeginFrame();
+        return true;
+    }
+
+    m_LastFrameSkippedTicks = 0;
+    UpdateOverloadGovernor();
 
     if (m_TimeScale > 0.f && m_SimTimeElapsed >= m_LastFixedUpdateTime)
     {
+        const ClockDurationType simTime = GetEffectiveSimTime();
+
         // Check how many steps to do. Need at least 1 so +1, and add any additional counts with the division
         // -1 before division to avoid rolling back 0 nanoseconds.
-        m_SimStepCount = 1 + (embU32)((m_SimTimeElapsed - m_LastFixedUpdateTime - 1) / m_TargetSimTime);
+        const embU32 dueSteps = 1 + (embU32)((m_SimTimeElapsed - m_LastFixedUpdateTime - 1) / simTime);
 
-        // if too many simulations to be done for this frame, perform only max sims
-        // roll back simulated time to the max sim time.
-        if (m_SimStepCount > MAX_SIM_STEPS)
-        {
-            printf("Warning: Skipping %d planned tick(s), rolled back by %ldns (%lf ticks)\n",
-                   m_SimStepCount - MAX_SIM_STEPS,
-                   m_SimTimeElapsed - (m_LastFixedUpdateTime + m_TargetSimTime * MAX_SIM_STEPS),
-                   (embF64)(m_SimTimeElapsed - (m_LastFixedUpdateTime + m_TargetSimTime * MAX_SIM_STEPS)) / (embF64)m_TargetSimTime);
-            // Note: by right, if m_SimTimeElapsed is directly equal to Max Sim time, the engine should
-            // be simulating the next tick, making the engine simulate MAX_SIM_STEPS + 1 this frame.
-            // To be pedantic, m_SimTimeElapsed should be set to a little BEFORE the max sim time.
-            // However, we'd want to reduce the time skip as much as possible. Plus, the missing timestep would be triggered the next frame anyway.
-            // Logic may seem inconsistent but this is an edge case and the side effects are not consiquential.
-            m_SimTimeElapsed = m_LastFixedUpdateTime + m_TargetSimTime * MAX_SIM_STEPS;
-            m_SimStepCount = MAX_SIM_STEPS;
-        }
+        // if too many simulations to be done for this frame, let the catch-up policy decide what to run and what to drop.
+        m_SimStepCount = ApplySimCatchUpPolicy(dueSteps);
 
         // Compute next update time
-        m_LastFixedUpdateTime += m_TargetSimTime * m_SimStepCount;
+        m_LastFixedUpdateTime += simTime * m_SimStepCount;
     }
 
     // printf("real time %lf, dt: %f, fixeddt: %f, timescale %f, sim time %lf, sim count %u, interp: %f\n",
@@ -155,6 +572,7 @@ embBool EngineClock::ShouldUpdate(embBool simActive) noexcept
     //        ShouldFixedUpdate(),
     //        GetFixedUpdateInterpAmount());
 
+    BeginFrame();
     return true;
 }
 
@@ -165,18 +583,92 @@ embU32 EngineClock::ShouldFixedUpdate() const noexcept
 
 embF32 EngineClock::GetFixedUpdateInterpAmount() const noexcept
 {
-    return 1.0f - ((embF32)(m_LastFixedUpdateTime - m_SimTimeElapsed) / (embF32)m_TargetSimTime);
+    if (m_IsSimThreaded)
+    {
+        // how far this frame is past the snapshot render acquired last (SimulationThread::AcquireLatestState).
+        const SimulationThread& simThread = SimulationThread::Instance();
+        const ClockDurationType tickPeriod = simThread.GetScaledTickPeriod();
+        if (tickPeriod <= 0)
+            return 1.0f;
+
+        const ClockDurationType sinceLastTick = m_LastUpdateTimePointEpoch - simThread.GetAcquiredState().tickEpoch;
+        return std::clamp((embF32)sinceLastTick / (embF32)tickPeriod, 0.0f, 1.0f);
+    }
+
+    // SPREAD/AUTO can leave ticks owed to later frames, sim time is then more than a tick past the last one run.
+    return std::clamp(1.0f - ((embF32)(m_LastFixedUpdateTime - m_SimTimeElapsed) / (embF32)GetEffectiveSimTime()),
+                      0.0f, 1.0f);
+}
+
+void EngineClock::SetClockSource(ClockSource* source) noexcept
+{
+    m_ClockSource = source ? source : &GetSystemClockSource();
+    ResetTimer();
+}
+
+ClockSource& EngineClock::GetClockSource() const noexcept
+{
+    return *m_ClockSource;
+}
+
+void EngineClock::SetFrameWaitFunc(FrameWaitFunc func, void* userData) noexcept
+{
+    m_FrameWaitFunc = func;
+    m_FrameWaitUserData = userData;
+    m_IsSpinWaiting = false; // spin bookkeeping would straddle the switch
+}
+
+IdleTaskQueue& EngineClock::GetIdleTaskQueue() noexcept
+{
+    return m_IdleTasks;
+}
+
+const ClockStats& EngineClock::GetStats() const noexcept
+{
+    return m_Stats;
+}
+
+void EngineClock::BeginFrame() noexcept
+{
+    FrameArena::Instance().NextFrame();
+    MemTracker::UpdatePeaks();
+    RecordFrameStats();
+}
+
+void EngineClock::RecordFrameStats() noexcept
+{
+    constexpr embF32 toMillis = 1000.f / (embF32)Clock::period::den;
+
+    m_Stats.Record(ClockStat::FRAME_TIME, (embF32)m_DT * toMillis);
+    m_Stats.Record(ClockStat::FIXED_TICKS, (embF32)m_SimStepCount);
+    m_Stats.Record(ClockStat::SKIPPED_TICKS, (embF32)m_LastFrameSkippedTicks);
+    m_Stats.Record(ClockStat::INTERP_AMOUNT, GetFixedUpdateInterpAmount());
+    m_Stats.Record(ClockStat::SLEEP_TIME, (embF32)m_LastFrameSleepTime * toMillis);
+    m_Stats.Record(ClockStat::SPIN_TIME, (embF32)m_LastFrameSpinTime * toMillis);
+    m_Stats.Record(ClockStat::IDLE_WORK_TIME, (embF32)m_LastFrameIdleWorkTime * toMillis);
+    m_Stats.Record(ClockStat::FRAME_MEMORY, (embF32)FrameArena::Instance().GetLastFrameBytes() / 1024.f);
+    m_Stats.CommitFrame();
 }
 
 void EngineClock::ResetTimer() noexcept
 {
-    m_LastUpdateTimePointEpoch = Clock::now().time_since_epoch().count();
-    m_AppStartTimePoint = Clock::now().time_since_epoch().count();
+    m_LastUpdateTimePointEpoch = m_ClockSource->Now();
+    m_AppStartTimePoint = m_LastUpdateTimePointEpoch;
     m_SimTimeElapsed = 0;
     m_RealTimeElapsed = 0;
     m_LastFixedUpdateTime = 0;
     m_TimeScale = 1.0f;
     m_SimStepCount = 0;
+    m_LastFrameSleepTime = 0;
+    m_LastFrameSpinTime = 0;
+    m_LastFrameIdleWorkTime = 0;
+    m_IdleWorkTimeAccum = 0;
+    m_IsSpinWaiting = false;
+    m_SimRateDivisor = 1;
+    m_OverloadedFrames = 0;
+    m_RecoveredFrames = 0;
+    m_LastFrameSkippedTicks = 0;
+    m_Stats.Reset();
 }
 
 EMB_NAMESPACE_END
@@ -2,11 +2,39 @@
 
 #include <chrono>
 
+#include "engine/clockstats.h"
+#include "engine/idletasks.h"
+#include "engine/services.h"
 #include "util/macros.h"
 #include "util/types.h"
 
 EMB_NAMESPACE_START
 
+// How EngineClock waits out the remaining frame time in ShouldUpdate.
+enum class FramePacingMode : embU8
+{
+    SPIN, // ShouldUpdate returns false until the frame is due. Caller busy-polls. Lowest latency, burns a core.
+    HYBRID, // ShouldUpdate sleeps for most of the remaining frame time, spins for the last slice, then returns true.
+};
+
+// What ShouldUpdate does when more fixed ticks are due than it is allowed to run in one frame.
+enum class SimCatchUpPolicy : embU8
+{
+    CLAMP, // run maxStepsPerFrame, drop the rest by rolling back sim time.
+    SPREAD, // run maxStepsPerFrame, carry the rest over to later frames. Only drops past maxTickDebt.
+    DOWNRATE, // CLAMP, and lower the sim rate while ticks cost more than real time allows.
+    AUTO, // SPREAD while the sim keeps up, DOWNRATE under sustained overload. Picked by the overload governor.
+};
+
+struct SimCatchUpSettings
+{
+    embU32 maxStepsPerFrame = 2; // most fixed ticks to run in a single frame
+    embU32 maxTickDebt = 8; // SPREAD: most ticks allowed to be carried over to later frames
+    embU32 maxRateDivisor = 4; // DOWNRATE: sim rate can drop down to targetSimRate / maxRateDivisor
+};
+
+class ClockSource;
+
 class EngineClock
 {
   public:
@@ -15,7 +43,11 @@ class EngineClock
     using ClockDurationType = ClockDuration::rep; // the underlying type of the value stored in the clock.
     using ClockTimePoint = Clock::time_point; // the time pulled from the Clock.
 
-    EMB_CLASS_SINGLETON_MACRO(EngineClock)
+    // Blocking wait that replaces sleeping while waiting out a frame, e.g. blocking on window events in the background.
+    // Waits up to timeout, returns true to cut the wait short and start the frame right away.
+    using FrameWaitFunc = embBool (*)(ClockDurationType timeout, void* userData);
+
+    EMB_CLASS_SERVICE_MACRO(EngineClock, ENGINE_CLOCK)
 
     EngineClock() noexcept;
 
@@ -45,10 +77,82 @@ class EngineClock
     void SetSimTimeScale(embF32 timeScale) noexcept;
     embF32 GetSimTimeScale() const noexcept;
 
+    // Moves fixed updates onto the SimulationThread. ShouldFixedUpdate always returns 0 on the main thread while on,
+    // and GetFixedUpdateInterpAmount interpolates against the sim snapshot Engine::Render acquired.
+    // Before Engine::Init, Init starts the sim thread. While running, starts or stops it right away (stopping waits
+    // for the current tick). Not supported while headless.
+    void SetSimulationThreaded(embBool threaded) noexcept;
+    embBool IsSimulationThreaded() const noexcept;
+
+    void SetFramePacingMode(FramePacingMode mode) noexcept;
+    FramePacingMode GetFramePacingMode() const noexcept;
+
+    // Only applies to fixed updates stepped on the main thread. While IsSimulationThreaded, the SimulationThread
+    // ignores the policy, settings and governor: it runs at the full sim rate and skips ahead on its own once it falls
+    // more than SIMTHREAD_MAX_CATCHUP_TICKS behind.
+    void SetSimCatchUpPolicy(SimCatchUpPolicy policy) noexcept;
+    SimCatchUpPolicy GetSimCatchUpPolicy() const noexcept;
+    // The policy actually applied last frame. Only differs from GetSimCatchUpPolicy when AUTO.
+    SimCatchUpPolicy GetActiveSimCatchUpPolicy() const noexcept;
+    void SetSimCatchUpSettings(const SimCatchUpSettings& settings) noexcept;
+    const SimCatchUpSettings& GetSimCatchUpSettings() const noexcept;
+
+    // Feeds how long one FixedUpdate took into the overload governor. Call once per fixed tick on the main thread.
+    void RecordFixedUpdateCost(ClockDurationType cost) noexcept;
+    // Fraction of real time the sim needs to keep up at the target sim rate. Above 1 = cannot keep up.
+    embF32 GetSimLoad() const noexcept;
+    // 1 while running at the target sim rate. N while downrated to targetSimRate / N.
+    embU32 GetSimRateDivisor() const noexcept;
+    // Fixed ticks that were due but carried over to later frames.
+    embU32 GetSimTickDebt() const noexcept;
+    // Fixed ticks that were dropped last frame.
+    embU32 GetLastFrameSkippedTicks() const noexcept;
+
+    // Time spent waiting for the last frame, split by how it was spent. Reported in microseconds.
+    // In SPIN mode, all the waiting is counted as spin time.
+    embU32 GetLastFrameSleepMicros() const noexcept;
+    embU32 GetLastFrameSpinMicros() const noexcept;
+    // Time spent running idle tasks out of the last frame's slack. In microseconds.
+    embU32 GetLastFrameIdleWorkMicros() const noexcept;
+    // Current estimate of how long a single OS sleep slice actually takes, overshoot included. In microseconds.
+    embU32 GetSleepEstimateMicros() const noexcept;
+
+    // Deferrable work that runs in the slack before the next frame is due, instead of sleeping/spinning it away.
+    IdleTaskQueue& GetIdleTaskQueue() noexcept;
+
+    // Rolling per-frame stats (frame time, ticks, pacing, frame memory), fed by ShouldUpdate. Safe to read from any thread.
+    const ClockStats& GetStats() const noexcept;
+
     // Reset timer to start state.
     void ResetTimer() noexcept;
 
+    // Swaps where time is pulled from. nullptr goes back to the system clock. Resets the timer.
+    // Source must outlive its use by EngineClock.
+    void SetClockSource(ClockSource* source) noexcept;
+    ClockSource& GetClockSource() const noexcept;
+
+    // Installs a blocking wait used instead of the sleep/spin pacing (in both pacing modes). Frames are no longer
+    // precise, meant for when nobody is looking. nullptr goes back to normal pacing.
+    void SetFrameWaitFunc(FrameWaitFunc func, void* userData) noexcept;
+
   private:
+    // Sleeps in small slices until the deadline is closer than the sleep estimate, then spins the rest.
+    // Returns the time point (epoch) when it stopped waiting.
+    ClockDurationType WaitUntil(ClockDurationType deadlineEpoch) noexcept;
+    // Feeds an observed sleep duration into the running overshoot estimate.
+    void UpdateSleepEstimate(ClockDurationType observedSleep) noexcept;
+
+    // Picks the catch-up policy for this frame and adjusts the sim rate divisor under overload.
+    void UpdateOverloadGovernor() noexcept;
+    // Trims dueSteps down to what the active policy allows to run this frame. Returns the steps to run.
+    embU32 ApplySimCatchUpPolicy(embU32 dueSteps) noexcept;
+    // Frame boundary: starts the next FrameArena frame, samples MemTracker peaks and records stats. Run once per ShouldUpdate that returns true.
+    void BeginFrame() noexcept;
+    // Pushes this frame's timings into m_Stats.
+    void RecordFrameStats() noexcept;
+    // Real duration of one fixed tick, including any downrating.
+    ClockDurationType GetEffectiveSimTime() const noexcept;
+
     ClockDurationType m_DT = 0; // time since last update
     ClockDurationType m_SimTimeElapsed = 0; // time elapsed in simulation, affected by time scale.
     ClockDurationType m_RealTimeElapsed = 0;
@@ -62,6 +166,76 @@ class EngineClock
 
     embF32 m_TimeScale = 1.0f;
     embU32 m_SimStepCount = 0; // number of sim steps to do for this frame
+    embBool m_IsSimThreaded = false; // fixed updates run on SimulationThread instead
+
+    // Catch-up and overload governor
+    SimCatchUpPolicy m_CatchUpPolicy = SimCatchUpPolicy::CLAMP;
+    SimCatchUpPolicy m_ActiveCatchUpPolicy = SimCatchUpPolicy::CLAMP;
+    SimCatchUpSettings m_CatchUpSettings {};
+    embF64 m_TickCostAvg = 0.0; // moving average of the cost of one fixed tick
+    embU32 m_SimRateDivisor = 1;
+    embU32 m_OverloadedFrames = 0; // consecutive frames the sim could not keep up
+    embU32 m_RecoveredFrames = 0; // consecutive frames the sim would keep up at the next higher rate
+    embU32 m_LastFrameSkippedTicks = 0;
+
+    // Frame pacing
+    FramePacingMode m_PacingMode = FramePacingMode::HYBRID;
+    ClockDurationType m_LastFrameSleepTime = 0; // time spent sleeping before the last frame
+    ClockDurationType m_LastFrameSpinTime = 0; // time spent spinning before the last frame
+    ClockDurationType m_LastFrameIdleWorkTime = 0; // time spent on idle tasks before the last frame
+    ClockDurationType m_IdleWorkTimeAccum = 0; // idle task time so far, while waiting for the upcoming frame
+    ClockDurationType m_SpinWaitStartEpoch = 0; // SPIN mode only. When the caller started polling for the next frame.
+    embBool m_IsSpinWaiting = false;
+
+    // Running mean and variance of how long one sleep slice really takes. Estimate = mean + 1 stddev.
+    embF64 m_SleepMean = 0.0;
+    embF64 m_SleepVariance = 0.0;
+    ClockDurationType m_SleepEstimate = 0;
+
+    ClockStats m_Stats;
+    IdleTaskQueue m_IdleTasks;
+
+    ClockSource* m_ClockSource = nullptr;
+
+    FrameWaitFunc m_FrameWaitFunc = nullptr;
+    void* m_FrameWaitUserData = nullptr;
+};
+
+// Where EngineClock pulls time from. Times are in EngineClock::Clock ticks since epoch.
+class ClockSource
+{
+  public:
+    virtual ~ClockSource() = default;
+
+    virtual EngineClock::ClockDurationType Now() const noexcept = 0;
+    virtual void SleepFor(EngineClock::ClockDurationType duration) noexcept = 0;
+    // False if time only moves when told to. EngineClock stops pacing/governing against it if so.
+    virtual embBool IsRealTime() const noexcept = 0;
+};
+
+// Wall-clock time. Default source.
+class SystemClockSource final : public ClockSource
+{
+  public:
+    EngineClock::ClockDurationType Now() const noexcept override;
+    void SleepFor(EngineClock::ClockDurationType duration) noexcept override;
+    embBool IsRealTime() const noexcept override;
+};
+
+// Time that only moves when advanced. Sleeping jumps straight to the end of the sleep, so anything paced
+// against it runs as fast as the CPU allows, and every frame/tick lands on exactly the same time point each run.
+class VirtualClockSource final : public ClockSource
+{
+  public:
+    EngineClock::ClockDurationType Now() const noexcept override;
+    void SleepFor(EngineClock::ClockDurationType duration) noexcept override;
+    embBool IsRealTime() const noexcept override;
+
+    void Advance(EngineClock::ClockDurationType duration) noexcept;
+    void SetTime(EngineClock::ClockDurationType timeEpoch) noexcept;
+
+  private:
+    EngineClock::ClockDurationType m_Now = 0;
 };
 
 EMB_NAMESPACE_END
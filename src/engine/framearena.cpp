@@ -0,0 +1,307 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "util/allocator.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "framearena.h"
+
+EMB_NAMESPACE_START
+
+using ChunkAllocator = TaggedHeapAllocator<MemTag::GENERAL>;
+
+// Chunk header takes a whole cache line, so the usable bytes start cache line aligned.
+constexpr embSizeT CHUNK_HEADER_SIZE = EMB_CACHE_LINE_SIZE;
+
+// The calling thread's sub-arena in the FrameArena it used last. arenaId 0 = none yet.
+struct ThreadArenaCache
+{
+    embU32 arenaId = 0;
+    void* threadArena = nullptr; // nullptr = uses the overflow arena
+};
+
+static constinit EMB_THREAD_LOCAL ThreadArenaCache t_ThreadArenaCache;
+static std::atomic<embU32> s_NextArenaId = 1;
+
+// Live FrameArenas, so exiting threads only hand sub-arenas back to arenas that still exist.
+static std::mutex s_LiveArenasLock;
+static FrameArena* s_LiveArenas = nullptr;
+
+// Sub-arenas the calling thread holds, one per FrameArena it allocated from (e.g. two engines on one thread), most
+// recently used first. Gives them all back when the thread exits.
+// Plain thread_local: __declspec(thread) doesn't run destructors.
+struct ThreadArenaSlots
+{
+    static constexpr embU32 SLOT_COUNT = 4;
+
+    struct Slot
+    {
+        embU32 arenaId = 0; // 0 = empty
+        FrameArena* arena = nullptr;
+        FrameArena::ThreadArena* threadArena = nullptr;
+    };
+
+    Slot slots[SLOT_COUNT];
+
+    ~ThreadArenaSlots() noexcept
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.arenaId != 0)
+                FrameArena::ReleaseThreadArena(slot.arena, slot.arenaId, slot.threadArena);
+        }
+        // allocations later in this thread's exit claim a sub-arena that is never given back, rare enough.
+        t_ThreadArenaCache = {};
+    }
+};
+
+static thread_local ThreadArenaSlots t_ThreadArenaSlots;
+
+static unsigned char* GetChunkData(void* chunk) noexcept
+{
+    return (unsigned char*)chunk + CHUNK_HEADER_SIZE;
+}
+
+// Start of an allocation of bytes at alignment placed offset bytes into a chunk, or nullptr if it doesn't fit.
+static unsigned char* FitInChunk(void* chunk, embSizeT chunkSize, embSizeT offset, embSizeT bytes, embSizeT alignment) noexcept
+{
+    unsigned char* data = GetChunkData(chunk);
+    const std::uintptr_t start = ((std::uintptr_t)(data + offset) + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+    if (start + bytes > (std::uintptr_t)(data + chunkSize))
+        return nullptr;
+    return (unsigned char*)start;
+}
+
+FrameArena::FrameArena() noexcept : m_ArenaId(s_NextArenaId.fetch_add(1, std::memory_order_relaxed))
+{
+    EMB_ASSERT_STATIC(sizeof(Chunk) <= CHUNK_HEADER_SIZE, "FrameArena chunk header doesn't fit CHUNK_HEADER_SIZE");
+
+    std::lock_guard lock(s_LiveArenasLock);
+    m_NextLiveArena = s_LiveArenas;
+    s_LiveArenas = this;
+}
+
+FrameArena::~FrameArena() noexcept
+{
+    {
+        std::lock_guard lock(s_LiveArenasLock);
+        FrameArena** link = &s_LiveArenas;
+        while (*link != this)
+            link = &(*link)->m_NextLiveArena;
+        *link = m_NextLiveArena;
+    }
+
+    const auto freeChunks = [](ThreadArena& threadArena) {
+        for (Arena& arena : threadArena.arenas)
+        {
+            Chunk* chunk = arena.first;
+            while (chunk != nullptr)
+            {
+                Chunk* next = chunk->next;
+                ChunkAllocator::Free(chunk, CHUNK_HEADER_SIZE + chunk->size, EMB_CACHE_LINE_SIZE);
+                chunk = next;
+            }
+        }
+    };
+
+    for (ThreadArena& threadArena : m_ThreadArenas)
+        freeChunks(threadArena);
+    freeChunks(m_OverflowArena);
+}
+
+void* FrameArena::Allocate(embSizeT bytes, embSizeT alignment) noexcept
+{
+    EMB_ASSERT_HARD(alignment != 0 && (alignment & (alignment - 1)) == 0, "FrameArena alignment must be a power of two");
+    const embU64 frame = m_FrameIndex.load(std::memory_order_acquire);
+
+    ThreadArena* threadArena = GetThreadArena();
+    if (EMB_BRANCH_LIKELY(threadArena != nullptr))
+        return AllocateFrom(threadArena->arenas[frame & 1], frame, bytes, alignment);
+
+    // out of sub-arenas, share the overflow one.
+    while (m_OverflowLock.test_and_set(std::memory_order_acquire))
+        EMB_CPU_PAUSE();
+    void* ptr = AllocateFrom(m_OverflowArena.arenas[frame & 1], frame, bytes, alignment);
+    m_OverflowLock.clear(std::memory_order_release);
+    return ptr;
+}
+
+FrameArena::ThreadArena* FrameArena::GetThreadArena() noexcept
+{
+    if (EMB_BRANCH_LIKELY(t_ThreadArenaCache.arenaId == m_ArenaId))
+        return (ThreadArena*)t_ThreadArenaCache.threadArena;
+
+    // switched FrameArenas, or first allocation from this thread.
+    ThreadArenaSlots::Slot* slots = t_ThreadArenaSlots.slots;
+    embU32 found = 0;
+    while (found < ThreadArenaSlots::SLOT_COUNT && slots[found].arenaId != m_ArenaId)
+        found++;
+
+    ThreadArenaSlots::Slot slot;
+    if (found < ThreadArenaSlots::SLOT_COUNT)
+        slot = slots[found];
+    else
+    {
+        // holding a sub-arena in too many FrameArenas, give back the least recently used one.
+        found = ThreadArenaSlots::SLOT_COUNT - 1;
+        if (slots[found].arenaId != 0)
+            ReleaseThreadArena(slots[found].arena, slots[found].arenaId, slots[found].threadArena);
+
+        slot = {m_ArenaId, this, ClaimThreadArena()};
+        if (slot.threadArena == nullptr)
+            printf("Warning: FrameArena ran out of thread sub-arenas (%u), thread will share the overflow arena\n", MAX_THREADS);
+    }
+
+    // move to the front.
+    for (; found > 0; found--)
+        slots[found] = slots[found - 1];
+    slots[0] = slot;
+
+    t_ThreadArenaCache.arenaId = m_ArenaId;
+    t_ThreadArenaCache.threadArena = slot.threadArena;
+    return slot.threadArena;
+}
+
+FrameArena::ThreadArena* FrameArena::ClaimThreadArena() noexcept
+{
+    for (embU32 i = 0; i < MAX_THREADS; i++)
+    {
+        embBool expected = false;
+        if (m_ThreadArenas[i].isClaimed.load(std::memory_order_relaxed)
+            || !m_ThreadArenas[i].isClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            continue;
+
+        embU32 claimed = m_ClaimedThreads.load(std::memory_order_relaxed);
+        while (claimed < i + 1 && !m_ClaimedThreads.compare_exchange_weak(claimed, i + 1, std::memory_order_release))
+        {
+        }
+        return &m_ThreadArenas[i];
+    }
+    return nullptr;
+}
+
+void FrameArena::ReleaseThreadArena(FrameArena* arena, embU32 arenaId, ThreadArena* threadArena) noexcept
+{
+    if (threadArena == nullptr)
+        return;
+
+    // the arena may be gone already, e.g. an engine torn down before its worker threads exit.
+    std::lock_guard lock(s_LiveArenasLock);
+    for (FrameArena* live = s_LiveArenas; live != nullptr; live = live->m_NextLiveArena)
+    {
+        if (live != arena || live->m_ArenaId != arenaId)
+            continue;
+
+        // what it allocated this frame stays valid, the next owner only rewinds it on a later frame.
+        threadArena->isClaimed.store(false, std::memory_order_release);
+        return;
+    }
+}
+
+void* FrameArena::AllocateFrom(Arena& arena, embU64 frame, embSizeT bytes, embSizeT alignment) noexcept
+{
+    if (arena.frame.load(std::memory_order_relaxed) != frame)
+    {
+        // first allocation this frame, what the arena held is from two frames ago.
+        arena.current = arena.first;
+        arena.offset = 0;
+        arena.usedBefore = 0;
+        arena.used.store(0, std::memory_order_relaxed);
+        arena.frame.store(frame, std::memory_order_release);
+    }
+
+    unsigned char* ptr = arena.current ? FitInChunk(arena.current, arena.current->size, arena.offset, bytes, alignment) : nullptr;
+    if (EMB_BRANCH_UNLIKELY(ptr == nullptr))
+    {
+        AdvanceChunk(arena, bytes, alignment);
+        ptr = FitInChunk(arena.current, arena.current->size, 0, bytes, alignment);
+    }
+
+    arena.offset = (embSizeT)(ptr + bytes - GetChunkData(arena.current));
+    arena.used.store(arena.usedBefore + arena.offset, std::memory_order_relaxed);
+    return ptr;
+}
+
+void FrameArena::AdvanceChunk(Arena& arena, embSizeT bytes, embSizeT alignment) noexcept
+{
+    // whatever is left of the current chunk goes unused this frame.
+    if (arena.current != nullptr)
+        arena.usedBefore += arena.current->size;
+
+    Chunk* next = arena.current ? arena.current->next : arena.first;
+    if (next == nullptr || FitInChunk(next, next->size, 0, bytes, alignment) == nullptr)
+    {
+        // chunk data is cache line aligned, only bigger alignments may need padding.
+        const embSizeT needed = bytes + (alignment > CHUNK_HEADER_SIZE ? alignment : 0);
+        const embSizeT size = std::max(CHUNK_SIZE, needed);
+
+        Chunk* chunk = new (ChunkAllocator::Allocate(CHUNK_HEADER_SIZE + size, EMB_CACHE_LINE_SIZE)) Chunk {next, size};
+        if (arena.current != nullptr)
+            arena.current->next = chunk;
+        else
+            arena.first = chunk;
+
+        m_ReservedBytes.fetch_add(CHUNK_HEADER_SIZE + size, std::memory_order_relaxed);
+        next = chunk;
+    }
+
+    arena.current = next;
+    arena.offset = 0;
+}
+
+void FrameArena::NextFrame() noexcept
+{
+    const embU64 frame = m_FrameIndex.load(std::memory_order_relaxed);
+
+    // sum up the sub-arenas that were used this frame. Threads still allocating for it may land just after, fine for stats.
+    embSizeT frameBytes = 0;
+    const auto addUsage = [&](const ThreadArena& threadArena) {
+        const Arena& arena = threadArena.arenas[frame & 1];
+        if (arena.frame.load(std::memory_order_acquire) == frame)
+            frameBytes += arena.used.load(std::memory_order_relaxed);
+    };
+
+    const embU32 claimed = std::min(m_ClaimedThreads.load(std::memory_order_acquire), MAX_THREADS);
+    for (embU32 i = 0; i < claimed; i++)
+        addUsage(m_ThreadArenas[i]);
+    addUsage(m_OverflowArena);
+
+    m_LastFrameBytes.store(frameBytes, std::memory_order_relaxed);
+    if (frameBytes > m_PeakFrameBytes.load(std::memory_order_relaxed))
+        m_PeakFrameBytes.store(frameBytes, std::memory_order_relaxed);
+
+    m_FrameIndex.store(frame + 1, std::memory_order_release);
+}
+
+embU64 FrameArena::GetFrameIndex() const noexcept
+{
+    return m_FrameIndex.load(std::memory_order_relaxed) - 1;
+}
+
+embSizeT FrameArena::GetLastFrameBytes() const noexcept
+{
+    return m_LastFrameBytes.load(std::memory_order_relaxed);
+}
+
+embSizeT FrameArena::GetPeakFrameBytes() const noexcept
+{
+    return m_PeakFrameBytes.load(std::memory_order_relaxed);
+}
+
+embSizeT FrameArena::GetReservedBytes() const noexcept
+{
+    return m_ReservedBytes.load(std::memory_order_relaxed);
+}
+
+void FrameArena::ResetPeakFrameBytes() noexcept
+{
+    m_PeakFrameBytes.store(0, std::memory_order_relaxed);
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Bump allocator for per-frame temporaries. Allocating is a pointer bump in the calling thread's own sub-arena, so
+// threads never contend. Nothing is freed individually: everything allocated during frame N is dropped at once at the
+// start of frame N + 2 (frame boundaries are EngineClock::ShouldUpdate returning true). Memory from frame N is still
+// valid during frame N + 1, e.g. for render to read what update built.
+// Chunks are kept across frames, so once warmed up a frame takes nothing from the heap.
+//
+// Don't keep frame memory around for longer than that, including in containers that outlive it and touch their
+// elements on destruction. Growing a container in frame memory leaves the old buffer behind until the reset, reserve
+// up front where the size is known.
+class FrameArena
+{
+  public:
+    // Threads that can hold a sub-arena at once. A thread gives its sub-arena back when it exits, the next thread to
+    // allocate picks it up, chunks included. Threads past this share one overflow sub-arena behind a spin lock.
+    static constexpr embU32 MAX_THREADS = 64;
+    // Size of each chunk a sub-arena grabs from the heap. Bigger allocations get a chunk of their own size.
+    static constexpr embSizeT CHUNK_SIZE = 256 * 1024;
+
+    EMB_CLASS_SERVICE_MACRO(FrameArena, FRAME_ARENA)
+
+    FrameArena() noexcept;
+    ~FrameArena() noexcept;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Any thread. Never returns nullptr. alignment must be a power of two.
+    void* Allocate(embSizeT bytes, embSizeT alignment = alignof(std::max_align_t)) noexcept;
+
+    // Frame boundary, run by EngineClock::ShouldUpdate. Closes the usage stats of the current frame and starts the next
+    // one. Each thread rewinds its own sub-arena the first time it allocates in a new frame, so this never touches
+    // memory other threads are using.
+    void NextFrame() noexcept;
+
+    // Any thread. Number of frame boundaries so far.
+    embU64 GetFrameIndex() const noexcept;
+    // Any thread. Bytes used by all threads in the last finished frame, alignment padding and chunk tails included.
+    embSizeT GetLastFrameBytes() const noexcept;
+    // Any thread. Highest GetLastFrameBytes so far, what the arenas would need to hold every frame in one chunk.
+    embSizeT GetPeakFrameBytes() const noexcept;
+    // Any thread. Heap memory held by all sub-arenas.
+    embSizeT GetReservedBytes() const noexcept;
+
+    // Forgets the peak, e.g. after a loading screen.
+    void ResetPeakFrameBytes() noexcept;
+
+  private:
+    struct Chunk
+    {
+        Chunk* next = nullptr;
+        embSizeT size = 0; // usable bytes after the header
+    };
+
+    // One thread's memory for one frame parity.
+    struct Arena
+    {
+        Chunk* first = nullptr;
+        Chunk* current = nullptr;
+        embSizeT offset = 0; // into current's usable bytes
+        embSizeT usedBefore = 0; // bytes of the chunks before current, counted whole
+        std::atomic<embU64> frame = 0; // frame the contents belong to, read by NextFrame
+        std::atomic<embSizeT> used = 0; // usedBefore + offset, read by NextFrame
+    };
+
+    // Even and odd frames alternate between the two arenas.
+    struct alignas(EMB_CACHE_LINE_SIZE) ThreadArena
+    {
+        Arena arenas[2];
+        std::atomic<embBool> isClaimed = false; // a live thread allocates from it
+    };
+
+    friend struct ThreadArenaSlots;
+
+    // Sub-arena of the calling thread, claimed on its first allocation. nullptr if all are taken.
+    ThreadArena* GetThreadArena() noexcept;
+    // Takes a free sub-arena. nullptr if all are taken.
+    ThreadArena* ClaimThreadArena() noexcept;
+    // Gives a sub-arena back, if arena is still alive. threadArena may be nullptr (the overflow arena). Any thread.
+    static void ReleaseThreadArena(FrameArena* arena, embU32 arenaId, ThreadArena* threadArena) noexcept;
+    void* AllocateFrom(Arena& arena, embU64 frame, embSizeT bytes, embSizeT alignment) noexcept;
+    // Moves arena on to a chunk that fits bytes at alignment, reusing or allocating one.
+    void AdvanceChunk(Arena& arena, embSizeT bytes, embSizeT alignment) noexcept;
+
+    const embU32 m_ArenaId; // tells apart arenas sharing an address over time, for the thread-local cache
+    std::atomic<embU64> m_FrameIndex = 1; // 0 is what unused arenas hold, always stale
+    std::atomic<embU32> m_ClaimedThreads = 0; // highest sub-arena index handed out + 1
+    FrameArena* m_NextLiveArena = nullptr; // list of live arenas, guarded by a lock in framearena.cpp
+
+    std::atomic<embSizeT> m_LastFrameBytes = 0;
+    std::atomic<embSizeT> m_PeakFrameBytes = 0;
+    std::atomic<embSizeT> m_ReservedBytes = 0;
+
+    std::atomic_flag m_OverflowLock = ATOMIC_FLAG_INIT;
+    ThreadArena m_OverflowArena;
+    ThreadArena m_ThreadArenas[MAX_THREADS];
+};
+
+//-------------------------------------------------------------------//
+//                              Adapters                             //
+//-------------------------------------------------------------------//
+
+// Allocator for engine containers (see util/allocator.h), backed by the FrameArena. Free does nothing.
+struct FrameAllocator
+{
+    static void* Allocate(embSizeT bytes, embSizeT alignment) noexcept
+    {
+        return FrameArena::Instance().Allocate(bytes, alignment);
+    }
+
+    static void Free(void*, embSizeT, embSizeT) noexcept {}
+};
+
+// Same for std containers and strings. Stateless, every instance is interchangeable.
+template<typename T>
+struct FrameStdAllocator
+{
+    using value_type = T;
+
+    FrameStdAllocator() noexcept = default;
+    template<typename U>
+    FrameStdAllocator(const FrameStdAllocator<U>&) noexcept
+    {}
+
+    T* allocate(embSizeT count) noexcept
+    {
+        return (T*)FrameArena::Instance().Allocate(count * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T*, embSizeT) noexcept {}
+
+    template<typename U>
+    bool operator==(const FrameStdAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+};
+
+template<typename T>
+using embFrameArray = embArray<T, FrameAllocator>; // valid for this frame and the next
+
+template<typename T>
+using embFrameLargeArray = embLargeArray<T, FrameAllocator>;
+
+// Frame string. Split into frame memory with StrSplitInto(embFrameArray<embFrameStr>&, ...).
+using embFrameStr = std::basic_string<char, std::char_traits<char>, FrameStdAllocator<char>>;
+
+EMB_NAMESPACE_END
@@ -0,0 +1,223 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "framegraph.h"
+#include "jobsystem.h"
+
+EMB_NAMESPACE_START
+
+FrameTaskGraph::TaskId FrameTaskGraph::AddTask(const FrameTaskDesc& desc) noexcept
+{
+    EMB_ASSERT_HARD(desc.func != nullptr, "frame task needs a function");
+
+    Task task;
+    task.desc = desc;
+    task.id = m_NextTaskId++;
+    m_Tasks.push_back(task);
+    m_IsDirty = true;
+    return task.id;
+}
+
+void FrameTaskGraph::RemoveTask(TaskId id) noexcept
+{
+    for (auto it = m_Tasks.begin(); it != m_Tasks.end(); it++)
+    {
+        if (it->id != id)
+            continue;
+
+        m_Tasks.erase(it);
+        m_IsDirty = true;
+        return;
+    }
+}
+
+void FrameTaskGraph::Build() noexcept
+{
+    for (embU32 i = 0; i < (embU32)FramePhase::ENUM_COUNT; i++)
+        BuildPhase((FramePhase)i);
+
+    m_IsDirty = false;
+}
+
+void FrameTaskGraph::BuildPhase(FramePhase phase) noexcept
+{
+    PhaseGraph& graph = m_Phases[(embSizeT)phase];
+    graph.nodes.clear();
+    graph.roots.clear();
+    graph.criticalPathLength = 0;
+
+    for (const Task& task : m_Tasks)
+    {
+        if (task.desc.phase != phase)
+            continue;
+
+        Node node;
+        node.graph = &graph;
+        node.task = &task;
+        graph.nodes.push_back(node);
+    }
+
+    // Walk tasks in the order they were added, tracking who last wrote each piece of data and who read it since.
+    // Read after write, write after read and write after write become edges. Read after read is free.
+    struct DataAccess
+    {
+        embU32 lastWriter = embU32_MAX;
+        embArray<embU32> readersSinceWrite;
+    };
+    embMap<embHash, DataAccess> access;
+
+    const auto addEdge = [&graph](embU32 from, embU32 to) {
+        if (from == to)
+            return;
+
+        embArray<embU32>& successors = graph.nodes[from].successors;
+        if (std::find(successors.begin(), successors.end(), to) != successors.end())
+            return;
+
+        successors.push_back(to);
+        graph.nodes[to].dependencyCount++;
+        graph.nodes[to].depth = std::max(graph.nodes[to].depth, graph.nodes[from].depth + 1);
+    };
+
+    for (embU32 i = 0; i < graph.nodes.size(); i++)
+    {
+        const FrameTaskDesc& desc = graph.nodes[i].task->desc;
+
+        for (const embHash data : desc.reads)
+        {
+            DataAccess& dataAccess = access[data];
+            if (dataAccess.lastWriter != embU32_MAX)
+                addEdge(dataAccess.lastWriter, i);
+            dataAccess.readersSinceWrite.push_back(i);
+        }
+
+        for (const embHash data : desc.writes)
+        {
+            DataAccess& dataAccess = access[data];
+            if (dataAccess.lastWriter != embU32_MAX)
+                addEdge(dataAccess.lastWriter, i);
+            for (const embU32 reader : dataAccess.readersSinceWrite)
+                addEdge(reader, i);
+
+            dataAccess.lastWriter = i;
+            dataAccess.readersSinceWrite.clear();
+        }
+    }
+
+    // Note: edges only ever point forward, so depths are final once every earlier node has been visited.
+    for (embU32 i = 0; i < graph.nodes.size(); i++)
+    {
+        if (graph.nodes[i].dependencyCount == 0)
+            graph.roots.push_back(i);
+        graph.criticalPathLength = std::max(graph.criticalPathLength, graph.nodes[i].depth);
+    }
+
+    graph.remainingDependencies = std::make_unique<std::atomic<embU32>[]>(graph.nodes.size());
+}
+
+void FrameTaskGraph::Execute(FramePhase phase) noexcept
+{
+    if (m_IsDirty)
+        Build();
+
+    PhaseGraph& graph = m_Phases[(embSizeT)phase];
+    if (graph.nodes.empty())
+        return;
+
+    for (embU32 i = 0; i < graph.nodes.size(); i++)
+        graph.remainingDependencies[i].store(graph.nodes[i].dependencyCount, std::memory_order_relaxed);
+    graph.remainingTasks.store((embU32)graph.nodes.size(), std::memory_order_relaxed);
+
+    for (const embU32 root : graph.roots)
+        Launch(graph, root);
+
+    // Help out until the phase is done. Main-thread-only tasks first, nobody else can run them.
+    JobSystem& jobSystem = JobSystem::Instance();
+    while (graph.remainingTasks.load(std::memory_order_acquire) != 0)
+    {
+        if (RunMainThreadNode(graph) || jobSystem.RunPendingJob())
+            continue;
+
+        EMB_CPU_PAUSE();
+    }
+}
+
+void FrameTaskGraph::Launch(PhaseGraph& graph, embU32 nodeIndex) noexcept
+{
+    Node& node = graph.nodes[nodeIndex];
+    if (!node.task->desc.isMainThreadOnly)
+    {
+        JobSystem::Instance().Run(RunNode, &node);
+        return;
+    }
+
+    std::lock_guard lock(graph.mainThreadMutex);
+    graph.mainThreadQueue.push_back(nodeIndex);
+}
+
+void FrameTaskGraph::RunNode(void* nodePtr) noexcept
+{
+    Node& node = *(Node*)nodePtr;
+    PhaseGraph& graph = *node.graph;
+
+    node.task->desc.func(node.task->desc.userData);
+
+    for (const embU32 successor : node.successors)
+    {
+        if (graph.remainingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            Launch(graph, successor);
+    }
+
+    graph.remainingTasks.fetch_sub(1, std::memory_order_release);
+}
+
+embBool FrameTaskGraph::RunMainThreadNode(PhaseGraph& graph) noexcept
+{
+    embU32 nodeIndex = 0;
+    {
+        std::lock_guard lock(graph.mainThreadMutex);
+        if (graph.mainThreadQueue.empty())
+            return false;
+
+        nodeIndex = graph.mainThreadQueue.back();
+        graph.mainThreadQueue.pop_back();
+    }
+
+    RunNode(&graph.nodes[nodeIndex]);
+    return true;
+}
+
+embU32 FrameTaskGraph::GetTaskCount(FramePhase phase) const noexcept
+{
+    return (embU32)m_Phases[(embSizeT)phase].nodes.size();
+}
+
+embU32 FrameTaskGraph::GetCriticalPathLength(FramePhase phase) const noexcept
+{
+    return m_Phases[(embSizeT)phase].criticalPathLength;
+}
+
+void FrameTaskGraph::PrintGraph() const noexcept
+{
+    for (embU32 phase = 0; phase < (embU32)FramePhase::ENUM_COUNT; phase++)
+    {
+        const PhaseGraph& graph = m_Phases[phase];
+        printf("Frame phase %u: %u task(s), critical path %u\n", phase, (embU32)graph.nodes.size(), graph.criticalPathLength);
+
+        for (const Node& node : graph.nodes)
+        {
+            printf("  %.*s (waits on %u)%s ->", (int)node.task->desc.name.size(), node.task->desc.name.data(),
+                   node.dependencyCount, node.task->desc.isMainThreadOnly ? " [main]" : "");
+            for (const embU32 successor : node.successors)
+                printf(" %.*s", (int)graph.nodes[successor].task->desc.name.size(), graph.nodes[successor].task->desc.name.data());
+            printf("\n");
+        }
+    }
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/hash.h"
+#include "util/macros.h"
+#include "util/str.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Which part of the frame a task runs in. Each phase is its own graph, run by the matching Engine call.
+enum class FramePhase : embU8
+{
+    UPDATE, // Engine::Update
+    RENDER, // Engine::Render
+    ENUM_COUNT
+};
+
+using FrameTaskFunc = void (*)(void* userData);
+
+// A system's per-frame work plus the data it touches. Data is identified by hash, usually of the type that holds it.
+// Tasks that touch the same data in a conflicting way (write/write or read/write) run in the order they were added,
+// everything else may run in parallel.
+struct FrameTaskDesc
+{
+    embStrView name; // for debugging. Must outlive the task.
+    FrameTaskFunc func = nullptr;
+    void* userData = nullptr;
+    FramePhase phase = FramePhase::UPDATE;
+    embBool isMainThreadOnly = false; // e.g. anything touching the GL context
+    embArray<embHash> reads;
+    embArray<embHash> writes;
+
+    template<typename T>
+    FrameTaskDesc& Reads() noexcept
+    {
+        reads.push_back(Hash::GetTypeHash<T>());
+        return *this;
+    }
+
+    template<typename T>
+    FrameTaskDesc& Writes() noexcept
+    {
+        writes.push_back(Hash::GetTypeHash<T>());
+        return *this;
+    }
+};
+
+// Runs the engine's per-frame systems as a dependency graph built from their declared reads/writes, instead of a
+// hand-ordered list of calls. The graph is built once (and again only when tasks change), then every frame the tasks
+// with nothing left to wait on are handed to the JobSystem. The main thread runs main-thread-only tasks and helps out
+// with jobs until the phase is done.
+class FrameTaskGraph
+{
+  public:
+    using TaskId = embU32;
+    static constexpr TaskId INVALID_TASK = 0;
+
+    EMB_CLASS_SERVICE_MACRO(FrameTaskGraph, FRAME_TASK_GRAPH)
+
+    // Adding/removing tasks rebuilds the graph before the next Execute. Not while a phase is executing.
+    TaskId AddTask(const FrameTaskDesc& desc) noexcept;
+    void RemoveTask(TaskId id) noexcept;
+
+    // Builds the dependency graph for every phase. Execute does this on its own when needed.
+    void Build() noexcept;
+    // Runs every task in a phase and returns once they are all done. Main thread only.
+    void Execute(FramePhase phase) noexcept;
+
+    embU32 GetTaskCount(FramePhase phase) const noexcept;
+    // Longest chain of dependent tasks in a phase. Equal to the task count means nothing can run in parallel.
+    embU32 GetCriticalPathLength(FramePhase phase) const noexcept;
+    // Prints each phase's tasks and what they wait on.
+    void PrintGraph() const noexcept;
+
+  private:
+    struct Task
+    {
+        FrameTaskDesc desc;
+        TaskId id = INVALID_TASK;
+    };
+
+    struct PhaseGraph;
+
+    struct Node
+    {
+        PhaseGraph* graph = nullptr;
+        const Task* task = nullptr;
+        embArray<embU32> successors; // indices into PhaseGraph::nodes
+        embU32 dependencyCount = 0;
+        embU32 depth = 1; // length of the longest chain ending at this node
+    };
+
+    struct PhaseGraph
+    {
+        embArray<Node> nodes;
+        embArray<embU32> roots; // nodes with no dependencies
+        std::unique_ptr<std::atomic<embU32>[]> remainingDependencies; // per node, reset every Execute
+        std::atomic<embU32> remainingTasks = 0;
+        embU32 criticalPathLength = 0;
+
+        // ready main-thread-only nodes
+        std::mutex mainThreadMutex;
+        embArray<embU32> mainThreadQueue;
+    };
+
+    void BuildPhase(FramePhase phase) noexcept;
+    static void Launch(PhaseGraph& graph, embU32 nodeIndex) noexcept;
+    static void RunNode(void* nodePtr) noexcept;
+    // Runs one ready main-thread-only node. Returns false if there was none.
+    static embBool RunMainThreadNode(PhaseGraph& graph) noexcept;
+
+    embArray<Task> m_Tasks;
+    embFixedSizeArray<PhaseGraph, (embSizeT)FramePhase::ENUM_COUNT> m_Phases;
+    TaskId m_NextTaskId = 1;
+    embBool m_IsDirty = true;
+};
+
+EMB_NAMESPACE_END
@@ -4,18 +4,24 @@
 #include <GLFW/glfw3.h>
 
 #include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/memtracker.h"
 #include "util/types.h"
 
 #include "graphics.h"
+#include "initgraph.h"
 #include "resourcemanager.h"
 #include "window.h"
 
 #define STB_IMAGE_IMPLEMENTATION
+#define STBI_MALLOC(bytes) ember::MemTracker::Allocate(ember::MemTag::GRAPHICS, bytes)
+#define STBI_REALLOC(ptr, bytes) ember::MemTracker::Reallocate(ember::MemTag::GRAPHICS, ptr, bytes)
+#define STBI_FREE(ptr) ember::MemTracker::Free(ember::MemTag::GRAPHICS, ptr)
 #include "../../lib/stb/stb_image.h"
 
 EMB_NAMESPACE_START
 
-void Graphics::Init()
+void Graphics::InitContext()
 {
     // Init GLEW. make sure is after window is created.
     glfwMakeContextCurrent((GLFWwindow*)WindowManager::Instance().GetWindowHandle());
@@ -34,7 +40,10 @@ void Graphics::Init()
                   << glewGetErrorString(err) << "| Code: " << err << " | abort program" << std::endl;
         exit(1);
     }
+}
 
+void Graphics::InitShaders()
+{
     // Load and compile shaders
     int success;
     char infoLog[512];
@@ -109,26 +118,29 @@ void Graphics::Init()
     // Cleanup shaders
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+}
 
-    // Load models
-    float vertices[] = {
-        // positions          // colors           // texture coords
-        0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,   // top right
-        0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,   // bottom right
-        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,   // bottom left
-        -0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f    // top left
-    };
-    unsigned int indices[] = {
-        0, 1, 3,   // first triangle
-        1, 2, 3    // second triangle
-    };
+void Graphics::DecodeTextures()
+{
+    // No GL calls in here, runs on a worker while the context comes up.
+    static constexpr const char* TEXTURE_PATHS[] = {"res/wall.jpg", "res/awesomeface.png"};
+    EMB_ASSERT_STATIC(std::size(TEXTURE_PATHS) == sizeof(m_DecodedImages) / sizeof(DecodedImage), "one decoded image per texture");
 
-    // Load image
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("res/wall.jpg", &width, &height, &nrChannels, 0);
+    for (embU32 i = 0; i < std::size(TEXTURE_PATHS); i++)
+    {
+        DecodedImage& image = m_DecodedImages[i];
+        image.data = stbi_load(TEXTURE_PATHS[i], &image.width, &image.height, &image.channels, 0);
+        if (image.data == nullptr)
+            printf("Warning: Failed to load %s: %s\n", TEXTURE_PATHS[i], stbi_failure_reason());
+    }
     //ResourceManager::Instance().LoadResourceExternal(ResourceType::TEXTURE_ALBEDO, 4444, (embGenericPtr)data);
     //ResourceHandle image = ResourceManager::Instance().GetResourceHandle(ResourceType::TEXTURE_ALBEDO, 4444);
+}
 
+void Graphics::UploadTextures()
+{
+    // Upload images decoded by DecodeTextures
+    DecodedImage& wallImage = m_DecodedImages[0];
     glGenTextures(1, &texture); // create texture handle
     glBindTexture(GL_TEXTURE_2D, texture); // bind it to bring texture into focus, takes all of the settings below.
     // set the texture wrapping/filtering options (on the currently bound texture object)
@@ -136,21 +148,39 @@ void Graphics::Init()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, wallImage.width, wallImage.height, 0, GL_RGB, GL_UNSIGNED_BYTE, wallImage.data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    stbi_image_free(wallImage.data);
+    wallImage = DecodedImage {};
 
     // load another one
-    data = stbi_load("res/awesomeface.png", &width, &height, &nrChannels, 0);
+    DecodedImage& faceImage = m_DecodedImages[1];
     glGenTextures(1, &texture2); // create texture handle
     glBindTexture(GL_TEXTURE_2D, texture2); // bind it to bring texture into focus, takes all of the settings below.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, faceImage.width, faceImage.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, faceImage.data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    stbi_image_free(faceImage.data);
+    faceImage = DecodedImage {};
+}
+
+void Graphics::InitMeshes()
+{
+    // Load models
+    float vertices[] = {
+        // positions          // colors           // texture coords
+        0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,   // top right
+        0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,   // bottom right
+        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,   // bottom left
+        -0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f    // top left
+    };
+    unsigned int indices[] = {
+        0, 1, 3,   // first triangle
+        1, 2, 3    // second triangle
+    };
 
     // Create VAO to store all of the below configs
     // VAO stores: VBO/EBO BINDINGS, glVertexAttribPointer, glEnableVertexAttribArray.
@@ -192,7 +222,10 @@ void Graphics::Init()
     // do same for tex @ layout 2
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2); // enable the vertex attribute feature for layout 0 (enables layout (location = 0))
+}
 
+void Graphics::BindResources()
+{
     // Set up the texture unit bindings
     // activate the texture unit first before binding texture
     // by default, the active texture is always GL_TEXTURE0
@@ -210,6 +243,42 @@ void Graphics::Init()
     glUniform1i(glGetUniformLocation(shaderProgram, "texture2"), 1); // "uniform sampler2D texture1" binds to GL_TEXTURE1
 }
 
+void Graphics::AddInitSteps(InitGraph& graph)
+{
+    // Decoding doesn't need GL, so it overlaps with window + context creation.
+    // Everything else touches the GL context and stays on the main thread.
+    InitStepDesc step;
+    step.name = "Graphics::DecodeTextures";
+    step.func = [](void*) { Graphics::Instance().DecodeTextures(); };
+    graph.AddStep(step);
+
+    step.isMainThreadOnly = true;
+    step.name = "Graphics::InitContext";
+    step.func = [](void*) { Graphics::Instance().InitContext(); };
+    step.dependencies = {"WindowManager::Init"};
+    graph.AddStep(step);
+
+    step.name = "Graphics::InitShaders";
+    step.func = [](void*) { Graphics::Instance().InitShaders(); };
+    step.dependencies = {"Graphics::InitContext"};
+    graph.AddStep(step);
+
+    step.name = "Graphics::InitMeshes";
+    step.func = [](void*) { Graphics::Instance().InitMeshes(); };
+    step.dependencies = {"Graphics::InitContext"};
+    graph.AddStep(step);
+
+    step.name = "Graphics::UploadTextures";
+    step.func = [](void*) { Graphics::Instance().UploadTextures(); };
+    step.dependencies = {"Graphics::InitContext", "Graphics::DecodeTextures"};
+    graph.AddStep(step);
+
+    step.name = "Graphics::BindResources";
+    step.func = [](void*) { Graphics::Instance().BindResources(); };
+    step.dependencies = {"Graphics::InitShaders", "Graphics::InitMeshes", "Graphics::UploadTextures"};
+    graph.AddStep(step);
+}
+
 void Graphics::Render()
 {
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -1,16 +1,29 @@
 #pragma once
 
+#include "engine/services.h"
 #include "util/macros.h"
 #include "util/types.h"
 
 EMB_NAMESPACE_START
 
+class InitGraph;
+
 class Graphics
 {
   public:
-    EMB_CLASS_SINGLETON_MACRO(Graphics)
+    EMB_CLASS_SERVICE_MACRO(Graphics, GRAPHICS)
+
+    // Adds the graphics init steps. They depend on the "WindowManager::Init" step.
+    void AddInitSteps(InitGraph& graph);
+
+    // Init steps, in dependency order. Everything but DecodeTextures needs the GL context (main thread).
+    void InitContext();
+    void DecodeTextures(); // any thread
+    void InitShaders();
+    void InitMeshes();
+    void UploadTextures(); // after DecodeTextures
+    void BindResources(); // after shaders, meshes and textures
 
-    void Init();
     void PreRender();
     void Render();
     void Destroy();
@@ -23,6 +36,17 @@ class Graphics
     unsigned int shaderProgram;
     unsigned int texture;
     unsigned int texture2;
+
+  private:
+    // Decoded on a worker by DecodeTextures, freed by UploadTextures.
+    struct DecodedImage
+    {
+        unsigned char* data = nullptr;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+    };
+    DecodedImage m_DecodedImages[2];
 };
 
 EMB_NAMESPACE_END
@@ -0,0 +1,126 @@
+#include "pch-engine.h"
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "engineclock.h"
+#include "idletasks.h"
+
+EMB_NAMESPACE_START
+
+// Cost assumed for a task's first slice, before anything has been measured.
+constexpr IdleTaskQueue::ClockDurationType IDLETASK_INITIAL_SLICE_COST =
+    std::chrono::duration_cast<EngineClock::ClockDuration>(std::chrono::microseconds(200)).count();
+// Weight of each new sample in a task's slice cost estimate.
+constexpr embF64 IDLETASK_COST_WEIGHT = 1.0 / 8.0;
+// Frames a task can go without a slice before it gets one regardless of slack.
+constexpr embU32 IDLETASK_STARVATION_FRAMES = 30;
+
+IdleTaskQueue::TaskId IdleTaskQueue::Submit(IdleTaskFunc func, void* userData) noexcept
+{
+    EMB_ASSERT_HARD(func != nullptr, "cannot submit null idle task");
+
+    IdleTask task;
+    task.func = func;
+    task.userData = userData;
+    task.id = m_NextTaskId++;
+    task.sliceCostEstimate = IDLETASK_INITIAL_SLICE_COST;
+
+    if (m_NextTaskId == INVALID_TASK)
+        m_NextTaskId++;
+
+    m_Tasks.push_back(task);
+    return task.id;
+}
+
+void IdleTaskQueue::Cancel(TaskId id) noexcept
+{
+    for (embU32 i = 0; i < m_Tasks.size(); i++)
+    {
+        if (m_Tasks[i].id != id)
+            continue;
+
+        m_Tasks.erase(m_Tasks.begin() + i);
+        if (m_NextTask > i)
+            m_NextTask--;
+        return;
+    }
+}
+
+embBool IdleTaskQueue::HasTasks() const noexcept
+{
+    return !m_Tasks.empty();
+}
+
+embU32 IdleTaskQueue::GetTaskCount() const noexcept
+{
+    return (embU32)m_Tasks.size();
+}
+
+embBool IdleTaskQueue::RunSlice(embU32 index, ClockSource& source) noexcept
+{
+    IdleTask& task = m_Tasks[index];
+
+    const ClockDurationType sliceStart = source.Now();
+    const embBool isDone = task.func(task.userData);
+    const ClockDurationType sliceCost = source.Now() - sliceStart;
+
+    if (isDone)
+    {
+        m_Tasks.erase(m_Tasks.begin() + index);
+        return true;
+    }
+
+    // Note: the task may have submitted new tasks, re-fetch instead of using the reference from above.
+    IdleTask& updatedTask = m_Tasks[index];
+    updatedTask.sliceCostEstimate += (ClockDurationType)(IDLETASK_COST_WEIGHT * (embF64)(sliceCost - updatedTask.sliceCostEstimate));
+    updatedTask.framesSinceLastSlice = 0;
+    return false;
+}
+
+IdleTaskQueue::ClockDurationType IdleTaskQueue::RunUntil(ClockDurationType deadlineEpoch, ClockSource& source) noexcept
+{
+    ClockDurationType now = source.Now();
+
+    // Round robin. Stop once a full pass over the tasks found nothing that fits.
+    embU32 tasksSkipped = 0;
+    while (!m_Tasks.empty() && tasksSkipped < m_Tasks.size())
+    {
+        if (m_NextTask >= m_Tasks.size())
+            m_NextTask = 0;
+
+        if (deadlineEpoch - now < m_Tasks[m_NextTask].sliceCostEstimate)
+        {
+            m_NextTask++;
+            tasksSkipped++;
+            continue;
+        }
+
+        // finished tasks are removed, the next task slides into this index.
+        if (!RunSlice(m_NextTask, source))
+            m_NextTask++;
+
+        tasksSkipped = 0;
+        now = source.Now();
+    }
+
+    return now;
+}
+
+void IdleTaskQueue::RunStarved(ClockSource& source) noexcept
+{
+    for (embU32 i = 0; i < m_Tasks.size();)
+    {
+        if (++m_Tasks[i].framesSinceLastSlice < IDLETASK_STARVATION_FRAMES)
+        {
+            i++;
+            continue;
+        }
+
+        if (!RunSlice(i, source))
+            i++;
+    }
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+class ClockSource;
+
+// One slice of deferrable work. Keep each call short (tens to hundreds of microseconds).
+// Return true once the task is finished, false to be called again in a later slice.
+using IdleTaskFunc = embBool (*)(void* userData);
+
+// Deferrable, time-sliced work (resource unloading, cache trimming, streaming decode...) that only runs in the slack
+// left over before the next frame is due. EngineClock runs it while waiting out the frame.
+// Tasks are run round robin, one slice at a time, and a slice is only started if its measured cost fits before the deadline.
+// Main thread only.
+class IdleTaskQueue
+{
+  public:
+    using TaskId = embU32;
+    using ClockDurationType = std::chrono::high_resolution_clock::duration::rep; // same as EngineClock::ClockDurationType
+
+    static constexpr TaskId INVALID_TASK = 0;
+
+    // Queues a task. userData must stay alive until the task finishes or is cancelled.
+    TaskId Submit(IdleTaskFunc func, void* userData) noexcept;
+    // Removes a task without running it again. No-op if it already finished. Do not call from inside a running task.
+    void Cancel(TaskId id) noexcept;
+
+    embBool HasTasks() const noexcept;
+    embU32 GetTaskCount() const noexcept;
+
+    // Runs slices until none fit before deadlineEpoch. Returns the time point it stopped at.
+    ClockDurationType RunUntil(ClockDurationType deadlineEpoch, ClockSource& source) noexcept;
+    // Call once per frame. Runs one slice of any task that got no slack for too many frames in a row,
+    // so work still drains when every frame runs late (or when there is never any real slack, e.g. headless).
+    void RunStarved(ClockSource& source) noexcept;
+
+  private:
+    struct IdleTask
+    {
+        IdleTaskFunc func = nullptr;
+        void* userData = nullptr;
+        TaskId id = INVALID_TASK;
+        ClockDurationType sliceCostEstimate = 0; // moving average of how long one slice takes
+        embU32 framesSinceLastSlice = 0;
+    };
+
+    // Runs one slice of the task at index. Returns true if it finished (and was removed).
+    embBool RunSlice(embU32 index, ClockSource& source) noexcept;
+
+    embArray<IdleTask> m_Tasks;
+    embU32 m_NextTask = 0; // round robin cursor
+    TaskId m_NextTaskId = 1;
+};
+
+EMB_NAMESPACE_END
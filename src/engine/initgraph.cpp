@@ -0,0 +1,192 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "initgraph.h"
+#include "jobsystem.h"
+
+EMB_NAMESPACE_START
+
+void InitGraph::AddStep(const InitStepDesc& desc) noexcept
+{
+    EMB_ASSERT_HARD(desc.func != nullptr, "init step needs a function");
+
+    Step step;
+    step.desc = desc;
+    step.graph = this;
+    m_Steps.push_back(step);
+}
+
+void InitGraph::ResolveDependencies() noexcept
+{
+    embMap<embStrView, embU32> stepIndices;
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+    {
+        const embBool isNew = stepIndices.emplace(m_Steps[i].desc.name, i).second;
+        EMB_ASSERT_HARD(isNew, "duplicate init step name");
+    }
+
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+    {
+        for (const embStrView dependency : m_Steps[i].desc.dependencies)
+        {
+            const auto it = stepIndices.find(dependency);
+            EMB_ASSERT_HARD(it != stepIndices.end(), "init step depends on a step that was never added");
+
+            m_Steps[it->second].successors.push_back(i);
+            m_Steps[i].dependencyCount++;
+        }
+    }
+
+    // Kahn's algorithm, just to make sure every step is reachable. A cycle would deadlock Run instead.
+    embArray<embU32> remaining(m_Steps.size());
+    embArray<embU32> ready;
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+    {
+        remaining[i] = m_Steps[i].dependencyCount;
+        if (remaining[i] == 0)
+            ready.push_back(i);
+    }
+
+    embU32 visited = 0;
+    while (!ready.empty())
+    {
+        const embU32 index = ready.back();
+        ready.pop_back();
+        visited++;
+
+        for (const embU32 successor : m_Steps[index].successors)
+        {
+            if (--remaining[successor] == 0)
+                ready.push_back(successor);
+        }
+    }
+    EMB_ASSERT_HARD(visited == m_Steps.size(), "init steps have a dependency cycle");
+}
+
+void InitGraph::Run() noexcept
+{
+    ResolveDependencies();
+
+    m_RemainingDependencies = std::make_unique<std::atomic<embU32>[]>(m_Steps.size());
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+        m_RemainingDependencies[i].store(m_Steps[i].dependencyCount, std::memory_order_relaxed);
+    m_RemainingSteps.store((embU32)m_Steps.size(), std::memory_order_relaxed);
+
+    m_StartTime = EngineClock::Clock::now().time_since_epoch().count();
+
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+    {
+        if (m_Steps[i].dependencyCount == 0)
+            Launch(i);
+    }
+
+    JobSystem& jobSystem = JobSystem::Instance();
+    while (m_RemainingSteps.load(std::memory_order_acquire) != 0)
+    {
+        if (RunMainThreadStep() || jobSystem.RunPendingJob())
+            continue;
+
+        EMB_CPU_PAUSE();
+    }
+
+    m_EndTime = EngineClock::Clock::now().time_since_epoch().count();
+}
+
+void InitGraph::Launch(embU32 stepIndex) noexcept
+{
+    Step& step = m_Steps[stepIndex];
+    if (!step.desc.isMainThreadOnly)
+    {
+        JobSystem::Instance().Run(RunStep, &step);
+        return;
+    }
+
+    std::lock_guard lock(m_MainThreadMutex);
+    m_MainThreadQueue.push_back(stepIndex);
+}
+
+void InitGraph::RunStep(void* stepPtr) noexcept
+{
+    Step& step = *(Step*)stepPtr;
+    InitGraph& graph = *step.graph;
+
+    step.workerIndex = JobSystem::Instance().GetCurrentWorkerIndex();
+    step.startTime = EngineClock::Clock::now().time_since_epoch().count();
+    step.desc.func(step.desc.userData);
+    step.endTime = EngineClock::Clock::now().time_since_epoch().count();
+
+    for (const embU32 successor : step.successors)
+    {
+        if (graph.m_RemainingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            graph.Launch(successor);
+    }
+
+    graph.m_RemainingSteps.fetch_sub(1, std::memory_order_release);
+}
+
+embBool InitGraph::RunMainThreadStep() noexcept
+{
+    embU32 stepIndex = 0;
+    {
+        std::lock_guard lock(m_MainThreadMutex);
+        if (m_MainThreadQueue.empty())
+            return false;
+
+        stepIndex = m_MainThreadQueue.back();
+        m_MainThreadQueue.pop_back();
+    }
+
+    RunStep(&m_Steps[stepIndex]);
+    return true;
+}
+
+void InitGraph::PrintTimings() const noexcept
+{
+    const auto toMs = [](ClockDurationType duration) {
+        return (embF64)duration * 1000.0 / (embF64)EngineClock::Clock::period::den;
+    };
+
+    // Longest chain by duration. Steps finish after their dependencies, so sorting by end time gives a valid order.
+    embArray<embU32> order(m_Steps.size());
+    for (embU32 i = 0; i < m_Steps.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this](embU32 a, embU32 b) { return m_Steps[a].endTime < m_Steps[b].endTime; });
+
+    embArray<ClockDurationType> chainTime(m_Steps.size(), 0);
+    ClockDurationType criticalPath = 0;
+    ClockDurationType totalWork = 0;
+    for (const embU32 index : order)
+    {
+        const Step& step = m_Steps[index];
+        chainTime[index] += step.endTime - step.startTime;
+        totalWork += step.endTime - step.startTime;
+        criticalPath = std::max(criticalPath, chainTime[index]);
+
+        for (const embU32 successor : step.successors)
+            chainTime[successor] = std::max(chainTime[successor], chainTime[index]);
+    }
+
+    const ClockDurationType wallTime = m_EndTime - m_StartTime;
+    printf("Startup took %.2fms (%.2fms of work, critical path %.2fms)\n", toMs(wallTime), toMs(totalWork), toMs(criticalPath));
+
+    for (const embU32 index : order)
+    {
+        const Step& step = m_Steps[index];
+        char threadName[32] = "main thread";
+        if (step.workerIndex != 0)
+            snprintf(threadName, sizeof(threadName), "worker %u", step.workerIndex);
+
+        printf("  %-24.*s start %8.2fms  took %8.2fms  on %s\n",
+               (int)step.desc.name.size(), step.desc.name.data(),
+               toMs(step.startTime - m_StartTime),
+               toMs(step.endTime - step.startTime),
+               threadName);
+    }
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "engine/engineclock.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/str.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+using InitStepFunc = void (*)(void* userData);
+
+struct InitStepDesc
+{
+    embStrView name; // also what other steps list as a dependency. Must outlive the graph.
+    InitStepFunc func = nullptr;
+    void* userData = nullptr;
+    embBool isMainThreadOnly = false; // window creation, anything touching the GL context
+    embArray<embStrView> dependencies; // names of steps that must finish first
+};
+
+// One-shot startup sequence driven by a dependency list. Steps run on the JobSystem as soon as everything they depend on
+// is done, so startup takes as long as the slowest chain instead of the sum of every step.
+// Main-thread-only steps run on the calling thread, which helps with jobs in between.
+class InitGraph
+{
+  public:
+    void AddStep(const InitStepDesc& desc) noexcept;
+
+    // Runs every step and returns once they are all done. Main thread only.
+    void Run() noexcept;
+
+    // Prints when each step ran, how long it took and on which thread, plus the critical path.
+    void PrintTimings() const noexcept;
+
+  private:
+    using ClockDurationType = EngineClock::ClockDurationType;
+
+    struct Step
+    {
+        InitStepDesc desc;
+        InitGraph* graph = nullptr;
+        embArray<embU32> successors;
+        embU32 dependencyCount = 0;
+
+        // filled in while running
+        ClockDurationType startTime = 0;
+        ClockDurationType endTime = 0;
+        embU32 workerIndex = 0;
+    };
+
+    // Resolves dependency names into successor lists. Asserts on unknown names and cycles.
+    void ResolveDependencies() noexcept;
+    void Launch(embU32 stepIndex) noexcept;
+    static void RunStep(void* stepPtr) noexcept;
+    embBool RunMainThreadStep() noexcept;
+
+    embArray<Step> m_Steps;
+    std::unique_ptr<std::atomic<embU32>[]> m_RemainingDependencies;
+    std::atomic<embU32> m_RemainingSteps = 0;
+    ClockDurationType m_StartTime = 0;
+    ClockDurationType m_EndTime = 0;
+
+    std::mutex m_MainThreadMutex;
+    embArray<embU32> m_MainThreadQueue;
+};
+
+EMB_NAMESPACE_END
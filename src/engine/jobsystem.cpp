@@ -0,0 +1,312 @@
+#include "pch-engine.h"
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "jobsystem.h"
+#include "threadmanager.h"
+
+EMB_NAMESPACE_START
+
+// Failed searches before an idle worker goes to sleep. Keeps wake-up latency low when jobs come in bursts.
+constexpr embU32 JOBSYSTEM_SPIN_ATTEMPTS = 256;
+
+static EMB_THREAD_LOCAL embU32 s_WorkerIndex = JobSystem::NOT_A_WORKER;
+
+//-------------------------------------------------------------------//
+//                             JobCounter                            //
+//-------------------------------------------------------------------//
+
+embBool JobCounter::IsDone() const noexcept
+{
+    return m_Pending.load(std::memory_order_acquire) == 0;
+}
+
+embU32 JobCounter::GetPendingCount() const noexcept
+{
+    return m_Pending.load(std::memory_order_acquire);
+}
+
+//-------------------------------------------------------------------//
+//                              JobDeque                             //
+//-------------------------------------------------------------------//
+
+void JobDeque::StoreSlot(embS64 index, const Job& job) noexcept
+{
+    Slot& slot = m_Slots[index & (CAPACITY - 1)];
+    slot.func.store(job.func, std::memory_order_relaxed);
+    slot.userData.store(job.userData, std::memory_order_relaxed);
+    slot.counter.store(job.counter, std::memory_order_relaxed);
+}
+
+void JobDeque::LoadSlot(embS64 index, Job& out) const noexcept
+{
+    const Slot& slot = m_Slots[index & (CAPACITY - 1)];
+    out.func = slot.func.load(std::memory_order_relaxed);
+    out.userData = slot.userData.load(std::memory_order_relaxed);
+    out.counter = slot.counter.load(std::memory_order_relaxed);
+}
+
+// Memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+
+embBool JobDeque::Push(const Job& job) noexcept
+{
+    const embS64 bottom = m_Bottom.load(std::memory_order_relaxed);
+    const embS64 top = m_Top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY)
+        return false;
+
+    StoreSlot(bottom, job);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+embBool JobDeque::Pop(Job& out) noexcept
+{
+    const embS64 bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+    m_Bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    embS64 top = m_Top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // empty
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    LoadSlot(bottom, out);
+    if (top != bottom)
+        return true;
+
+    // last job, race the stealers for it.
+    const embBool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+}
+
+embBool JobDeque::Steal(Job& out) noexcept
+{
+    embS64 top = m_Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const embS64 bottom = m_Bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+        return false;
+
+    LoadSlot(top, out);
+    return m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------//
+//                             JobSystem                             //
+//-------------------------------------------------------------------//
+
+void JobSystem::Init(embU32 workerThreadCount) noexcept
+{
+    EMB_ASSERT_HARD(!m_IsRunning, "JobSystem already initialized");
+
+    if (workerThreadCount == 0)
+    {
+        const embU32 coreCount = std::thread::hardware_concurrency();
+        workerThreadCount = coreCount > 1 ? coreCount - 1 : 0;
+    }
+
+    m_WorkerCount = workerThreadCount + 1; // + main thread
+    m_Workers = std::make_unique<Worker[]>(m_WorkerCount);
+    m_IsRunning = true;
+
+    s_WorkerIndex = 0;
+    for (embU32 i = 0; i < m_WorkerCount; i++)
+        m_Workers[i].stealSeed = 0x9E3779B9u * (i + 1);
+
+    // workers see the same services as the thread that spawned them
+    for (embU32 i = 1; i < m_WorkerCount; i++)
+        m_Workers[i].thread = std::thread(&JobSystem::WorkerMain, this, i, ServiceRegistry::GetCurrent());
+}
+
+void JobSystem::Destroy() noexcept
+{
+    if (!m_IsRunning)
+        return;
+
+    // drain whatever is still queued before pulling the workers down.
+    while (TryRunJob(0))
+    {
+    }
+
+    m_IsRunning = false;
+    m_WorkSignal.fetch_add(1, std::memory_order_seq_cst);
+    m_WorkSignal.notify_all();
+
+    for (embU32 i = 1; i < m_WorkerCount; i++)
+        m_Workers[i].thread.join();
+
+    m_Workers.reset();
+    m_WorkerCount = 0;
+    s_WorkerIndex = NOT_A_WORKER;
+}
+
+void JobSystem::Run(JobFunc func, void* userData, JobCounter* counter) noexcept
+{
+    EMB_ASSERT_HARD(func != nullptr, "cannot run a null job");
+
+    const Job job {func, userData, counter};
+    if (counter != nullptr)
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    // not running (or torn down): just do it here.
+    if (!m_IsRunning)
+    {
+        Execute(job);
+        return;
+    }
+
+    const embU32 workerIndex = s_WorkerIndex;
+    if (workerIndex == NOT_A_WORKER)
+    {
+        std::lock_guard lock(m_ExternalMutex);
+        m_ExternalJobs.push_back(job);
+        m_ExternalJobCount.fetch_add(1, std::memory_order_release);
+    }
+    else if (!m_Workers[workerIndex].deque.Push(job))
+    {
+        // deque full, running it inline is the cheapest form of back pressure.
+        Execute(job);
+        return;
+    }
+
+    WakeWorkers();
+}
+
+void JobSystem::Wait(const JobCounter& counter) noexcept
+{
+    const embU32 workerIndex = s_WorkerIndex;
+    while (!counter.IsDone())
+    {
+        // help out instead of blocking. Non-workers can only run external jobs, so they just spin.
+        if (workerIndex != NOT_A_WORKER && TryRunJob(workerIndex))
+            continue;
+
+        EMB_CPU_PAUSE();
+        std::this_thread::yield();
+    }
+}
+
+embBool JobSystem::RunPendingJob() noexcept
+{
+    const embU32 workerIndex = s_WorkerIndex;
+    if (!m_IsRunning || workerIndex == NOT_A_WORKER)
+        return false;
+
+    return TryRunJob(workerIndex);
+}
+
+embU32 JobSystem::GetWorkerCount() const noexcept
+{
+    return m_WorkerCount;
+}
+
+embU32 JobSystem::GetCurrentWorkerIndex() const noexcept
+{
+    return s_WorkerIndex;
+}
+
+void JobSystem::WorkerMain(embU32 workerIndex, ServiceRegistry* services) noexcept
+{
+    s_WorkerIndex = workerIndex;
+    ServiceRegistry::SetCurrent(services);
+    ThreadManager::Instance().ApplyToCurrentThread(ThreadRole::WORKER, workerIndex);
+
+    embU32 failedAttempts = 0;
+    while (m_IsRunning.load(std::memory_order_acquire))
+    {
+        if (TryRunJob(workerIndex))
+        {
+            failedAttempts = 0;
+            continue;
+        }
+
+        if (++failedAttempts < JOBSYSTEM_SPIN_ATTEMPTS)
+        {
+            EMB_CPU_PAUSE();
+            continue;
+        }
+
+        // Announce the sleep before reading the signal, Run bumps the signal before checking for sleepers.
+        // One of the two always sees the other, so a submitted job can't be missed.
+        m_SleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        const embU32 signal = m_WorkSignal.load(std::memory_order_seq_cst);
+        if (!TryRunJob(workerIndex) && m_IsRunning.load(std::memory_order_acquire))
+            m_WorkSignal.wait(signal, std::memory_order_seq_cst);
+        m_SleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        failedAttempts = 0;
+    }
+
+    // finish off anything left in our deque, nobody else will.
+    while (TryRunJob(workerIndex))
+    {
+    }
+}
+
+embBool JobSystem::FindJob(embU32 workerIndex, Job& out) noexcept
+{
+    Worker& self = m_Workers[workerIndex];
+    if (self.deque.Pop(out))
+        return true;
+
+    if (m_ExternalJobCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard lock(m_ExternalMutex);
+        if (!m_ExternalJobs.empty())
+        {
+            out = m_ExternalJobs.back();
+            m_ExternalJobs.pop_back();
+            m_ExternalJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Steal, starting from a random victim so workers don't all hammer the same deque.
+    self.stealSeed ^= self.stealSeed << 13;
+    self.stealSeed ^= self.stealSeed >> 17;
+    self.stealSeed ^= self.stealSeed << 5;
+    const embU32 start = self.stealSeed % m_WorkerCount;
+    for (embU32 i = 0; i < m_WorkerCount; i++)
+    {
+        const embU32 victim = (start + i) % m_WorkerCount;
+        if (victim != workerIndex && m_Workers[victim].deque.Steal(out))
+            return true;
+    }
+
+    return false;
+}
+
+embBool JobSystem::TryRunJob(embU32 workerIndex) noexcept
+{
+    Job job;
+    if (!FindJob(workerIndex, job))
+        return false;
+
+    Execute(job);
+    return true;
+}
+
+void JobSystem::Execute(const Job& job) noexcept
+{
+    job.func(job.userData);
+
+    if (job.counter != nullptr)
+        job.counter->m_Pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WakeWorkers() noexcept
+{
+    m_WorkSignal.fetch_add(1, std::memory_order_seq_cst);
+    if (m_SleepingWorkers.load(std::memory_order_seq_cst) > 0)
+        m_WorkSignal.notify_one();
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+using JobFunc = void (*)(void* userData);
+
+// Counts jobs still in flight. Hand one to JobSystem::Run and JobSystem::Wait on it to wait for all of them.
+// Can be reused once done. Must outlive the jobs it counts.
+class JobCounter
+{
+  public:
+    embBool IsDone() const noexcept;
+    embU32 GetPendingCount() const noexcept;
+
+  private:
+    friend class JobSystem;
+    std::atomic<embU32> m_Pending = 0;
+};
+
+//-------------------------------------------------------------------//
+//                              JobDeque                             //
+//-------------------------------------------------------------------//
+
+// Chase-Lev work-stealing deque with a fixed capacity. The owning worker pushes/pops at the bottom (LIFO, hot in cache),
+// other workers steal from the top (FIFO, the oldest and usually biggest work).
+// Job fields are stored as atomics so a steal that loses the race never reads torn data.
+class JobDeque
+{
+  public:
+    struct Job
+    {
+        JobFunc func = nullptr;
+        void* userData = nullptr;
+        JobCounter* counter = nullptr;
+    };
+
+    static constexpr embS64 CAPACITY = 4096;
+    EMB_ASSERT_STATIC((CAPACITY & (CAPACITY - 1)) == 0, "JobDeque capacity must be a power of two");
+
+    // Owner only. Returns false if full.
+    embBool Push(const Job& job) noexcept;
+    // Owner only. Returns false if empty (or the last job got stolen).
+    embBool Pop(Job& out) noexcept;
+    // Any thread. Returns false if empty or another thread got there first.
+    embBool Steal(Job& out) noexcept;
+
+  private:
+    struct Slot
+    {
+        std::atomic<JobFunc> func = nullptr;
+        std::atomic<void*> userData = nullptr;
+        std::atomic<JobCounter*> counter = nullptr;
+    };
+
+    void StoreSlot(embS64 index, const Job& job) noexcept;
+    void LoadSlot(embS64 index, Job& out) const noexcept;
+
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embS64> m_Top = 0; // stealers
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embS64> m_Bottom = 0; // owner
+    alignas(EMB_CACHE_LINE_SIZE) Slot m_Slots[CAPACITY];
+};
+
+//-------------------------------------------------------------------//
+//                             JobSystem                             //
+//-------------------------------------------------------------------//
+
+// Work-stealing job system shared by the whole engine. One worker thread per core (minus the main thread), each with its
+// own deque. The main thread counts as worker 0: it can run jobs, and helps out while waiting on a counter.
+// Threads that aren't workers (e.g. the sim thread) can still submit, their jobs go through a shared locked queue.
+// With no worker threads (single core), those only run when the main thread waits on a counter.
+// Jobs should not block, wait on counters instead.
+class JobSystem
+{
+  public:
+    using Job = JobDeque::Job;
+    static constexpr embU32 NOT_A_WORKER = embU32_MAX;
+
+    EMB_CLASS_SERVICE_MACRO(JobSystem, JOB_SYSTEM)
+
+    // Spawns the workers. workerThreadCount 0 = one per core, minus the main thread. Call from the main thread.
+    void Init(embU32 workerThreadCount = 0) noexcept;
+    // Finishes queued jobs and joins the workers.
+    void Destroy() noexcept;
+
+    // Queues a job. counter (optional) is incremented now and decremented once the job has run.
+    void Run(JobFunc func, void* userData, JobCounter* counter = nullptr) noexcept;
+    // Runs other jobs until counter hits 0. Safe to call from inside a job.
+    void Wait(const JobCounter& counter) noexcept;
+    // Runs one queued job on the calling thread, if there is one. For loops that wait on something other than a counter.
+    // Returns false if nothing ran (or the calling thread is not a worker).
+    embBool RunPendingJob() noexcept;
+
+    // Worker threads + the main thread.
+    embU32 GetWorkerCount() const noexcept;
+    // Index of the calling thread, 0 for the main thread, NOT_A_WORKER for threads outside the job system.
+    embU32 GetCurrentWorkerIndex() const noexcept;
+
+  private:
+    struct alignas(EMB_CACHE_LINE_SIZE) Worker
+    {
+        JobDeque deque;
+        std::thread thread;
+        embU32 stealSeed = 0; // xorshift state for picking victims
+    };
+
+    void WorkerMain(embU32 workerIndex, ServiceRegistry* services) noexcept;
+    // Finds a job for this worker: own deque, then the external queue, then steals. Returns false if nothing found.
+    embBool FindJob(embU32 workerIndex, Job& out) noexcept;
+    embBool TryRunJob(embU32 workerIndex) noexcept;
+    void Execute(const Job& job) noexcept;
+    void WakeWorkers() noexcept;
+
+    std::unique_ptr<Worker[]> m_Workers;
+    embU32 m_WorkerCount = 0;
+
+    // submissions from non-worker threads
+    std::mutex m_ExternalMutex;
+    embLargeArray<Job> m_ExternalJobs;
+    std::atomic<embU32> m_ExternalJobCount = 0;
+
+    // sleeping workers wait on this changing
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU32> m_WorkSignal = 0;
+    std::atomic<embU32> m_SleepingWorkers = 0;
+    std::atomic<embBool> m_IsRunning = false;
+};
+
+EMB_NAMESPACE_END
@@ -0,0 +1,131 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "engineclock.h"
+#include "mainthreadqueue.h"
+
+EMB_NAMESPACE_START
+
+MainThreadQueue::MainThreadQueue() noexcept
+{
+    for (embU32 i = 0; i < CAPACITY; i++)
+        m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+MainThreadQueue::~MainThreadQueue() noexcept
+{
+    // whatever never got drained only gets its captures destroyed, the main thread resources are likely gone by now.
+    while (RunNext(false))
+    {
+    }
+}
+
+embBool MainThreadQueue::ClaimSlot(embU64& outPosition) noexcept
+{
+    embU64 position = m_EnqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        const Slot& slot = m_Slots[position & (CAPACITY - 1)];
+        const embU64 sequence = slot.sequence.load(std::memory_order_acquire);
+        const embS64 diff = (embS64)(sequence - position);
+
+        if (diff == 0)
+        {
+            // slot is free for this lap, race the other producers for it.
+            if (m_EnqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                outPosition = position;
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the main thread hasn't drained this slot from the previous lap yet.
+            m_FailedPostCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+embBool MainThreadQueue::RunNext(embBool execute) noexcept
+{
+    const embU64 position = m_DequeuePos.load(std::memory_order_relaxed);
+    Slot& slot = m_Slots[position & (CAPACITY - 1)];
+
+    // claimed but not published yet counts as empty, keeps commands in order.
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        return false;
+
+    slot.thunk(slot.storage, execute);
+
+    // hand the slot to the producer one lap ahead.
+    slot.sequence.store(position + CAPACITY, std::memory_order_release);
+    m_DequeuePos.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void MainThreadQueue::Drain(embF32 budgetSeconds) noexcept
+{
+    using Clock = EngineClock::Clock;
+
+    const Clock::time_point start = Clock::now();
+    const Clock::duration budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<embF32>(budgetSeconds));
+
+    m_Stats.depthAtDrain = GetDepth();
+    m_Stats.peakDepthAtDrain = std::max(m_Stats.peakDepthAtDrain, m_Stats.depthAtDrain);
+    m_Stats.executedCount = 0;
+
+    while (RunNext(true))
+    {
+        m_Stats.executedCount++;
+        if (budgetSeconds > 0.f && Clock::now() - start >= budget)
+            break;
+    }
+
+    m_Stats.deferredCount = GetDepth();
+    m_Stats.drainTime = std::chrono::duration<embF32>(Clock::now() - start).count();
+    m_Stats.failedPostCount = m_FailedPostCount.load(std::memory_order_relaxed);
+
+    if (m_Stats.deferredCount > 0 && m_Stats.depthAtDrain > CAPACITY / 2)
+        printf("Warning: MainThreadQueue over half full (%u commands), %u deferred to next frame\n", m_Stats.depthAtDrain,
+               m_Stats.deferredCount);
+}
+
+void MainThreadQueue::DrainAll() noexcept
+{
+    Drain(0.f);
+}
+
+void MainThreadQueue::SetFrameBudget(embF32 budgetSeconds) noexcept
+{
+    EMB_ASSERT_HARD(budgetSeconds >= 0.f, "negative MainThreadQueue budget");
+    m_FrameBudget = budgetSeconds;
+}
+
+embF32 MainThreadQueue::GetFrameBudget() const noexcept
+{
+    return m_FrameBudget;
+}
+
+embU32 MainThreadQueue::GetDepth() const noexcept
+{
+    const embU64 dequeuePos = m_DequeuePos.load(std::memory_order_acquire);
+    const embU64 enqueuePos = m_EnqueuePos.load(std::memory_order_acquire);
+    return enqueuePos > dequeuePos ? (embU32)std::min<embU64>(enqueuePos - dequeuePos, CAPACITY) : 0;
+}
+
+const MainThreadQueueStats& MainThreadQueue::GetStats() const noexcept
+{
+    return m_Stats;
+}
+
+EMB_NAMESPACE_END
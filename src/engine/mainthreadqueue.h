@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "engine/services.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+struct MainThreadQueueStats
+{
+    embU32 depthAtDrain = 0; // commands waiting when the last drain started
+    embU32 peakDepthAtDrain = 0; // highest depthAtDrain so far
+    embU32 executedCount = 0; // commands run by the last drain
+    embU32 deferredCount = 0; // commands left for next frame by the last drain (over budget)
+    embF32 drainTime = 0.f; // seconds spent in the last drain
+    embU32 failedPostCount = 0; // posts rejected because the queue was full, since start
+};
+
+// Commands that must run on the main thread (anything touching GL or GLFW), posted from any thread.
+// Lock-free multi-producer single-consumer ring: producers claim a slot with a CAS, the main thread drains in order.
+// Closures are stored inline in the slot, so posting never allocates. Captures must fit INLINE_SIZE bytes.
+// Drained once per frame by Engine::Update, within a time budget so a burst of uploads can't eat a whole frame.
+class MainThreadQueue
+{
+  public:
+    static constexpr embU32 CAPACITY = 1024;
+    static constexpr embSizeT INLINE_SIZE = 48;
+    EMB_ASSERT_STATIC((CAPACITY & (CAPACITY - 1)) == 0, "MainThreadQueue capacity must be a power of two");
+
+    EMB_CLASS_SERVICE_MACRO(MainThreadQueue, MAIN_THREAD_QUEUE)
+
+    MainThreadQueue() noexcept;
+    ~MainThreadQueue() noexcept;
+
+    // Any thread. Queues func() to run on the main thread. Returns false (and drops func) if the queue is full.
+    template<typename F>
+    embBool Post(F&& func) noexcept
+    {
+        using Func = std::decay_t<F>;
+        EMB_ASSERT_STATIC(sizeof(Func) <= INLINE_SIZE, "MainThreadQueue command captures too much, pass a pointer instead");
+        EMB_ASSERT_STATIC(alignof(Func) <= alignof(std::max_align_t), "MainThreadQueue command is over-aligned");
+        EMB_ASSERT_STATIC(std::is_nothrow_move_constructible_v<Func> || std::is_trivially_copyable_v<Func>,
+                          "MainThreadQueue command must be nothrow movable");
+
+        embU64 position = 0;
+        if (!ClaimSlot(position))
+            return false;
+
+        Slot& slot = m_Slots[position & (CAPACITY - 1)];
+        new (slot.storage) Func(std::forward<F>(func));
+        slot.thunk = [](void* storage, embBool execute) {
+            Func& f = *(Func*)storage;
+            if (execute)
+                f();
+            f.~Func();
+        };
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Main thread only. Runs queued commands until the queue is empty or budgetSeconds has passed.
+    // Always runs at least one command, so a tiny budget still makes progress.
+    void Drain(embF32 budgetSeconds) noexcept;
+    // Main thread only. Runs everything queued, ignoring the budget. Commands posted meanwhile run too.
+    void DrainAll() noexcept;
+
+    // Time budget Engine::Update drains with. 0 = unlimited.
+    void SetFrameBudget(embF32 budgetSeconds) noexcept;
+    embF32 GetFrameBudget() const noexcept;
+
+    // Any thread. Commands currently queued, approximate while producers are posting.
+    embU32 GetDepth() const noexcept;
+    const MainThreadQueueStats& GetStats() const noexcept;
+
+  private:
+    using CommandThunk = void (*)(void* storage, embBool execute); // runs (if execute) then destroys the closure
+
+    struct alignas(EMB_CACHE_LINE_SIZE) Slot
+    {
+        // == position when free for that lap's producer, position + 1 once published for the consumer.
+        std::atomic<embU64> sequence = 0;
+        CommandThunk thunk = nullptr;
+        alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    };
+
+    // Reserves the slot for the next enqueue position. Returns false if the queue is full.
+    embBool ClaimSlot(embU64& outPosition) noexcept;
+    // Pops and runs (or just destroys) the oldest command. Returns false if there is none ready.
+    embBool RunNext(embBool execute) noexcept;
+
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_EnqueuePos = 0; // producers
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_DequeuePos = 0; // main thread writes, others read for depth
+    std::atomic<embU32> m_FailedPostCount = 0;
+    embF32 m_FrameBudget = 0.002f;
+    MainThreadQueueStats m_Stats;
+
+    Slot m_Slots[CAPACITY];
+};
+
+EMB_NAMESPACE_END
@@ -13,7 +13,21 @@ EMB_NAMESPACE_START
 //                            ResourceHandle                         //
 //-------------------------------------------------------------------//
 
-embMap<embU32, embU16> ResourceHandle::s_HandleRefCount {};
+ResourceHandle::ResourceHandle(ResourceType type, embU16 slot)
+    : m_TypeIndex {(embU16)type}
+    , m_SlotIndex {slot}
+{
+    const embU16 refCount = ResourceManager::Instance().AddHandleRef(type, slot);
+    printf("constructor: ref count for type %u slot %u is %u\n", m_TypeIndex, m_SlotIndex, refCount); // todo remove
+}
+
+ResourceHandle::ResourceHandle(const ResourceHandle& obj)
+    : m_TypeIndex {(embU16)obj.m_TypeIndex}
+    , m_SlotIndex {obj.m_SlotIndex}
+{
+    const embU16 refCount = ResourceManager::Instance().AddHandleRef((ResourceType)m_TypeIndex, m_SlotIndex);
+    printf("copyconstructor/assign: ref count for type %u slot %u is %u\n", m_TypeIndex, m_SlotIndex, refCount); // todo remove
+}
 
 void* ResourceHandle::GetData() const noexcept
 {
@@ -32,19 +46,75 @@ void* ResourceHandle::GetData() const noexcept
 ResourceHandle::~ResourceHandle() // destructor
 {
     // decrement ref counter
-    embU32 key = (embU32)m_SlotIndex | ((embU32)m_TypeIndex << 16); // hardcode slot to u16
-    EMB_ASSERT_HARD(s_HandleRefCount[key] > 0, "attempting to decrement ref count when count is already 0!");
-    s_HandleRefCount[key]--;
-    printf("destructor: ref count for key %u is %u\n", key, s_HandleRefCount[key]); // todo remove
+    const embU16 refCount = ResourceManager::Instance().ReleaseHandleRef((ResourceType)m_TypeIndex, m_SlotIndex);
+    printf("destructor: ref count for type %u slot %u is %u\n", m_TypeIndex, m_SlotIndex, refCount); // todo remove
 
     // If count == 0, unload resource.
     // TODO implement smarter logic to defer unloading after a little bit longer?
-    if (s_HandleRefCount[key] == 0)
+    if (refCount == 0)
     {
         ResourceManager::Instance().UnloadResource((ResourceType)m_TypeIndex, m_SlotIndex);
     }
 }
 
+ResourceManager::ResourceManager() noexcept
+{
+    for (embSizeT i = 0; i < (embSizeT)ResourceType::ENUM_COUNT; i++)
+    {
+        PoolDesc desc = RESMGR_POOL_DESCS[i];
+        desc.memTag = MemTag::RESOURCES;
+#ifdef EMB_DEF_RESMGR_GUARD_PAGES
+        desc.useGuardPages = true;
+#endif
+        m_Pools[i].Init(desc);
+    }
+}
+
+ResourceManager::~ResourceManager() noexcept
+{
+    // whatever is still loaded goes back to its pool before the pools go away.
+    for (embSizeT i = 0; i < (embSizeT)ResourceType::ENUM_COUNT; i++)
+    {
+        const ResourceType resType = (ResourceType)i;
+        m_PooledSlots[i].ForEachSetBit([&](embU32 slot) {
+            DestroyResourceData(resType, m_ResourceStore.GetResourceData(resType, (ResourceStore::ResourceSlotIndex)slot));
+        });
+    }
+}
+
+embU16 ResourceManager::AddHandleRef(ResourceType resType, ResourceStore::ResourceSlotIndex slot) noexcept
+{
+    EMB_ASSERT_HARD(resType < ResourceType::ENUM_COUNT && slot < RESMGR_RESOURCE_COUNT, "handle out of range");
+    embU16& refCount = m_HandleRefCounts[(embSizeT)resType][slot];
+    EMB_ASSERT_HARD(refCount < embU16_MAX, "attempting to increment ref count past max capacity!");
+    return ++refCount;
+}
+
+embU16 ResourceManager::ReleaseHandleRef(ResourceType resType, ResourceStore::ResourceSlotIndex slot) noexcept
+{
+    EMB_ASSERT_HARD(resType < ResourceType::ENUM_COUNT && slot < RESMGR_RESOURCE_COUNT, "handle out of range");
+    embU16& refCount = m_HandleRefCounts[(embSizeT)resType][slot];
+    EMB_ASSERT_HARD(refCount > 0, "attempting to decrement ref count when count is already 0!");
+    return --refCount;
+}
+
+void ResourceManager::DestroyResourceData(ResourceType resType, embRawPointer data) noexcept
+{
+    EMB_ASSERT_HARD(resType < ResourceType::ENUM_COUNT, "resType out of range");
+    if (data == nullptr)
+        return;
+
+    if (m_RecordDestructors[(embSizeT)resType] != nullptr)
+        m_RecordDestructors[(embSizeT)resType](data);
+    m_Pools[(embSizeT)resType].Free(data);
+}
+
+const PoolAllocator& ResourceManager::GetResourcePool(ResourceType resType) const noexcept
+{
+    EMB_ASSERT_HARD(resType < ResourceType::ENUM_COUNT, "resType out of range");
+    return m_Pools[(embSizeT)resType];
+}
+
 ResourceHandle ResourceManager::GetResourceHandle(embResourceTypeGuid resTypeGuid, embResourceGuid resGuid) noexcept
 {
     ResourceType resType = EMB_X_ENUM_FROM_HASH(ResourceType, resTypeGuid);
@@ -1,10 +1,13 @@
 #pragma once
+#include "engine/services.h"
+#include "util/bitset.h"
 #include "util/containers.h"
 #include "util/hash.h"
 #include "util/macros.h"
 #include "util/macros_debug.h"
 #include "util/macros_util.h"
 #include "util/math.h"
+#include "util/poolallocator.h"
 #include "util/str.h"
 #include "util/types.h"
 
@@ -14,7 +17,9 @@
 #include <cstddef>
 #include <initializer_list>
 #include <memory>
+#include <new>
 #include <set>
+#include <type_traits>
 #include <unistd.h>
 #include <unordered_map>
 #include <utility>
@@ -31,6 +36,7 @@ EMB_NAMESPACE_START
 #else
 #    define EMB_IFDEF_VALIDATE_RESMGR(code)
 #endif
+// #define EMB_DEF_RESMGR_GUARD_PAGES // debug only: every resource pool uses guard pages, see PoolAllocator
 
 using embRawPointer = void*;
 using embResourceGuid = embU32;
@@ -69,6 +75,27 @@ EMB_X_DEF_ENUM_FROM_HASH(ResourceType, X_LIST_RESOURCETYPE)
 
 #undef X_LIST_RESOURCETYPE
 
+// Pool each ResourceType's records are allocated from, in ResourceType order. Records are the small runtime side of a
+// resource (GPU handles, metadata), bulk data like pixels or samples lives elsewhere.
+constexpr PoolDesc RESMGR_POOL_DESCS[] = {
+    {.blockSize = 64, .blocksPerSlab = 128}, // SHADER_VERTEX
+    {.blockSize = 64, .blocksPerSlab = 128}, // SHADER_FRAG
+    {.blockSize = 64, .blocksPerSlab = 64}, // SHADER_PROGRAM
+    {.blockSize = 64, .blocksPerSlab = 256}, // TEXTURE_SPRITE
+    {.blockSize = 64, .blocksPerSlab = 256}, // TEXTURE_ALBEDO
+    {.blockSize = 128, .blocksPerSlab = 128}, // AUDIO
+    {.blockSize = 256, .blocksPerSlab = 16}, // FONT_TTF
+    {.blockSize = 256, .blocksPerSlab = 16}, // SCENE
+};
+EMB_ASSERT_STATIC(std::size(RESMGR_POOL_DESCS) == (embSizeT)ResourceType::ENUM_COUNT, "missing ResourceType in RESMGR_POOL_DESCS");
+
+// Record LoadResource builds for types without a record type of their own yet: which resource the slot holds.
+struct ResourceRecord
+{
+    ResourceType type;
+    embResourceGuid guid;
+};
+
 //-------------------------------------------------------------------//
 //                            ResourceHandle                         //
 //-------------------------------------------------------------------//
@@ -78,28 +105,10 @@ EMB_X_DEF_ENUM_FROM_HASH(ResourceType, X_LIST_RESOURCETYPE)
 struct ResourceHandle
 {
   private:
-    ResourceHandle(ResourceType type, embU16 slot) // private default constructor, only "factory" can create
-        : m_TypeIndex {(embU16)type}
-        , m_SlotIndex {slot}
-    {
-        // increment ref counter
-        embU32 key = (embU32)slot | ((embU32)type << 16); // hardcode slot to u16
-        EMB_ASSERT_HARD(s_HandleRefCount[key] <= PowerIntUnsigned((embU32)2, RESHDL_SLOT_INDEX_BITS), "attempting to increment ref count past max capacity! Consider increasing RESHDL_SLOT_INDEX_BITS");
-        s_HandleRefCount[key]++;
-        printf("constructor: ref count for key %u is %u\n", key, s_HandleRefCount[key]); // todo remove
-    }
+    ResourceHandle(ResourceType type, embU16 slot); // private default constructor, only "factory" can create
 
   public:
-    ResourceHandle(const ResourceHandle& obj) // copy constructor
-        : m_TypeIndex {(embU16)obj.m_TypeIndex}
-        , m_SlotIndex {obj.m_SlotIndex}
-    {
-        // increment ref counter
-        embU32 key = (embU32)m_SlotIndex | ((embU32)m_TypeIndex << 16); // hardcode slot to u16
-        EMB_ASSERT_HARD(s_HandleRefCount[key] <= PowerIntUnsigned((embU32)2, RESHDL_SLOT_INDEX_BITS), "attempting to increment ref count past max capacity! Consider increasing RESHDL_SLOT_INDEX_BITS");
-        s_HandleRefCount[key]++;
-        printf("copyconstructor/assign: ref count for key %u is %u\n", key, s_HandleRefCount[key]); // todo remove
-    }
+    ResourceHandle(const ResourceHandle& obj); // copy constructor
 
     ResourceHandle& operator=(const ResourceHandle& obj) // copy assignment
     {
@@ -127,9 +136,6 @@ struct ResourceHandle
     embU16 m_SlotIndex : RESHDL_SLOT_INDEX_BITS;
     EMB_IFDEF_VALIDATE_RESMGR(embU16 m_Parity : RESHDL_PARITY_BITS);
 
-    // global map just to count handle references
-    static embMap<embU32, embU16> s_HandleRefCount;
-
     friend class ResourceManager;
 };
 
@@ -189,6 +195,7 @@ class ResourceStore
 
         m_PointerGuids[(embSizeT)resType][slot] = 0;
         m_Pointers[(embSizeT)resType][slot] = nullptr;
+        m_OccupiedSlots[(embSizeT)resType].reset(slot);
     }
 
     // Adds new entry to the store.
@@ -203,24 +210,24 @@ class ResourceStore
         EMB_ASSERT_HARD(GetResourceDataSlotFromGuid(resType, resGuid) == RESMGR_INVALID_SLOT,
                         "attempted to set new resource while it is already in store");
 
-        // Find new slot and set.
-        for (embU32 i = 0; i < RESMGR_RESOURCE_COUNT; i++)
+        // Find new slot and set. Scans the occupancy bits 64 slots at a time.
+        const embU32 slot = m_OccupiedSlots[(embSizeT)resType].FindFirstClear();
+        if (slot == SlotBitset::NOT_FOUND)
         {
-            if (m_PointerGuids[(embSizeT)resType][i] == 0)
-            {
-                EMB_IFDEF_VALIDATE_RESMGR(EMB_ASSERT_HARD(
-                    m_Pointers[(embSizeT)resType][i] == nullptr,
-                    "Desynchronized m_PointerGuids and m_Pointers, possibly prior to call."));
-
-                m_PointerGuids[(embSizeT)resType][i] = resGuid;
-                m_Pointers[(embSizeT)resType][i] = ptr;
-                return i;
-            }
+            // crash if no more slots
+            EMB_ASSERT_HARD(false,
+                            "unable to SetNewResourceData, ran out of slots! consider increasing RESOURCEMANAGER_RESOURCE_COUNT.");
+            return RESMGR_INVALID_SLOT;
         }
-        // crash if no more slots
-        EMB_ASSERT_HARD(false,
-                        "unable to SetNewResourceData, ran out of slots! consider increasing RESOURCEMANAGER_RESOURCE_COUNT.");
-        return RESMGR_INVALID_SLOT;
+
+        EMB_IFDEF_VALIDATE_RESMGR(EMB_ASSERT_HARD(
+            m_PointerGuids[(embSizeT)resType][slot] == 0 && m_Pointers[(embSizeT)resType][slot] == nullptr,
+            "Desynchronized m_OccupiedSlots, m_PointerGuids and m_Pointers, possibly prior to call."));
+
+        m_PointerGuids[(embSizeT)resType][slot] = resGuid;
+        m_Pointers[(embSizeT)resType][slot] = ptr;
+        m_OccupiedSlots[(embSizeT)resType].set(slot);
+        return slot;
     }
 
     // Modifies existing data.
@@ -270,6 +277,10 @@ class ResourceStore
     using GuidArray = embFixedSizeArray<embResourceGuid, RESMGR_RESOURCE_COUNT>;
     embFixedSizeArray<GuidArray, (embU64)ResourceType::ENUM_COUNT> m_PointerGuids {};
 
+    // bit set = slot in use. Kept in sync with m_PointerGuids.
+    using SlotBitset = embBitset<RESMGR_RESOURCE_COUNT>;
+    embFixedSizeArray<SlotBitset, (embU64)ResourceType::ENUM_COUNT> m_OccupiedSlots {};
+
 #ifdef EMB_DEF_VALIDATE_RESMGR
     using ParityArray = embFixedSizeArray<embU16, RESMGR_RESOURCE_COUNT>;
     embFixedSizeArray<ParityArray, (embU64)ResourceType::ENUM_COUNT> m_Parity {};
@@ -284,7 +295,10 @@ class ResourceStore
 class ResourceManager
 {
   public:
-    EMB_CLASS_SINGLETON_MACRO(ResourceManager)
+    EMB_CLASS_SERVICE_MACRO(ResourceManager, RESOURCE_MANAGER)
+
+    ResourceManager() noexcept;
+    ~ResourceManager() noexcept;
 
     ResourceStore& GetResourceStore() noexcept
     {
@@ -314,10 +328,17 @@ class ResourceManager
 
         // do some loading from external source
         // TODO if resGuid not found, assert.
-        void* ret = (void*)1234; // temp testing, return something other than nullptr
+        ResourceRecord* record = CreateResourceData<ResourceRecord>(resType, resType, resGuid);
 
         // add resource to backing store. Note that ref count is still 0 at this point.
-        m_ResourceStore.AddNewResourceData(resType, resGuid, ret);
+        const ResourceStore::ResourceSlotIndex slot = m_ResourceStore.AddNewResourceData(resType, resGuid, record);
+        if (slot == RESMGR_INVALID_SLOT)
+        {
+            // store is full (asserted in debug), the record has nowhere to go.
+            DestroyResourceData(resType, record);
+            return;
+        }
+        m_PooledSlots[(embSizeT)resType].set(slot); // freed by UnloadResource
     }
     void LoadResource(embResourceTypeGuid resTypeGuid, embResourceGuid resGuid)
     {
@@ -342,16 +363,69 @@ class ResourceManager
     // Called when need to unload and free data from resourceManager
     void UnloadResource(ResourceType resType, ResourceStore::ResourceSlotIndex slot)
     {
+        embRawPointer data = m_ResourceStore.GetResourceData(resType, slot);
+
         // Remove entry from ResourceStore
         m_ResourceStore.RemoveResourceDataEntry(resType, slot);
 
-        // TODO actually free the data.. via mem manager or delete or whatever.
-        // Probably want to unload via unique ptr delete
+        // pooled data is ours to free. Externally loaded data belongs to whoever handed it over.
+        if (m_PooledSlots[(embSizeT)resType].test(slot))
+        {
+            m_PooledSlots[(embSizeT)resType].reset(slot);
+            DestroyResourceData(resType, data);
+        }
         printf("Unloading resource!\n");
     }
 
+    // Constructs a resource record in resType's pool, for loaders. Each ResourceType has one record type (asserted), which must fit
+    // its RESMGR_POOL_DESCS entry. O(1), never touches the general heap once the pool has warmed up.
+    template<typename T, typename... Args>
+    T* CreateResourceData(ResourceType resType, Args&&... args) noexcept
+    {
+        EMB_ASSERT_HARD(resType < ResourceType::ENUM_COUNT, "resType out of range");
+        PoolAllocator& pool = m_Pools[(embSizeT)resType];
+        EMB_ASSERT_HARD(sizeof(T) <= pool.GetBlockSize() && alignof(T) <= pool.GetBlockAlignment(),
+                        "resource record doesn't fit its pool, check RESMGR_POOL_DESCS");
+
+        // every pooled slot of a type is destroyed with the type's one destructor, a second record type would get the wrong one.
+#ifdef EMB_DEF_VALIDATE_RESMGR
+        embHash& recordType = m_RecordTypes[(embSizeT)resType];
+        EMB_ASSERT_HARD(recordType == 0 || recordType == Hash::GetTypeHash<T>(), "ResourceType already has a different record type");
+        recordType = Hash::GetTypeHash<T>();
+#endif
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            m_RecordDestructors[(embSizeT)resType] = [](void* ptr) { ((T*)ptr)->~T(); };
+        return new (pool.Allocate()) T(std::forward<Args>(args)...);
+    }
+
+    // Destroys and frees a record from CreateResourceData. UnloadResource already does this for LoadResource's data.
+    void DestroyResourceData(ResourceType resType, embRawPointer data) noexcept;
+
+    // Block size, usage and memory of a type's pool, e.g. for a debug overlay.
+    const PoolAllocator& GetResourcePool(ResourceType resType) const noexcept;
+
   private:
+    friend struct ResourceHandle;
+
+    // Handle reference counting, returns the count after the change.
+    embU16 AddHandleRef(ResourceType resType, ResourceStore::ResourceSlotIndex slot) noexcept;
+    embU16 ReleaseHandleRef(ResourceType resType, ResourceStore::ResourceSlotIndex slot) noexcept;
+
     ResourceStore m_ResourceStore;
+
+    // live handles per slot. Per manager, like everything else here: not thread-safe, one engine's thread at a time.
+    using RefCountArray = embFixedSizeArray<embU16, RESMGR_RESOURCE_COUNT>;
+    embFixedSizeArray<RefCountArray, (embSizeT)ResourceType::ENUM_COUNT> m_HandleRefCounts {};
+
+    using RecordDestructor = void (*)(void*);
+    embFixedSizeArray<PoolAllocator, (embSizeT)ResourceType::ENUM_COUNT> m_Pools;
+    embFixedSizeArray<RecordDestructor, (embSizeT)ResourceType::ENUM_COUNT> m_RecordDestructors {};
+#ifdef EMB_DEF_VALIDATE_RESMGR
+    embFixedSizeArray<embHash, (embSizeT)ResourceType::ENUM_COUNT> m_RecordTypes {}; // type hash of each type's record
+#endif
+    // bit set = the slot's data came from m_Pools, and is freed on unload.
+    embFixedSizeArray<ResourceStore::SlotBitset, (embSizeT)ResourceType::ENUM_COUNT> m_PooledSlots {};
 };
 
 EMB_NAMESPACE_END
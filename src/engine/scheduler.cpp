@@ -0,0 +1,193 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "engineclock.h"
+#include "scheduler.h"
+#include "simthread.h"
+
+EMB_NAMESPACE_START
+
+SystemScheduler::SystemId SystemScheduler::Register(const ScheduledSystemDesc& desc) noexcept
+{
+    EMB_ASSERT_HARD(desc.func != nullptr, "cannot schedule a system without a function");
+    EMB_ASSERT_HARD(SimulationThread::Instance().IsFixedUpdateThread(), "SystemScheduler used off the thread running fixed updates");
+    EMB_ASSERT_HARD(desc.rateHz > 0.f, "scheduled system rate must be positive");
+
+    if (m_SimRate == 0.f)
+        m_SimRate = GetEffectiveSimRate();
+
+    ScheduledSystem system;
+    system.desc = desc;
+    system.id = m_NextSystemId++;
+    system.periodTicks = ComputePeriodTicks(desc.rateHz);
+    system.isAutoPhase = desc.phaseTicks < 0;
+    system.phaseTicks = system.isAutoPhase ? PickLeastBusyPhase(system.periodTicks)
+                                           : (embU32)desc.phaseTicks % system.periodTicks;
+
+    AddSlotCost(system, 1.f);
+    m_Systems.push_back(system);
+    return system.id;
+}
+
+void SystemScheduler::Unregister(SystemId id) noexcept
+{
+    EMB_ASSERT_HARD(SimulationThread::Instance().IsFixedUpdateThread(), "SystemScheduler used off the thread running fixed updates");
+    for (auto it = m_Systems.begin(); it != m_Systems.end(); it++)
+    {
+        if (it->id != id || it->isRemoved)
+            continue;
+
+        AddSlotCost(*it, -1.f);
+        // Tick walks m_Systems by index, erasing mid-walk would skip the next system. Erased once the walk is done.
+        if (m_IsTicking)
+        {
+            it->isRemoved = true;
+            m_HasRemovedSystems = true;
+        }
+        else
+            m_Systems.erase(it);
+        return;
+    }
+}
+
+void SystemScheduler::Tick() noexcept
+{
+    // periods are in ticks, so they go stale when the sim rate (or the governor's rate divisor) changes.
+    if (GetEffectiveSimRate() != m_SimRate)
+        Rebuild();
+
+    const embF32 fixedDT = EngineClock::Instance().GetFixedDT();
+    m_IsTicking = true;
+    for (embU32 i = 0; i < m_Systems.size(); i++)
+    {
+        const ScheduledSystem& system = m_Systems[i];
+        if (system.isRemoved || (m_TickIndex + system.periodTicks - system.phaseTicks) % system.periodTicks != 0)
+            continue;
+
+        system.desc.func(fixedDT * (embF32)system.periodTicks, system.desc.userData);
+    }
+    m_IsTicking = false;
+
+    if (m_HasRemovedSystems)
+    {
+        m_Systems.erase(std::remove_if(m_Systems.begin(), m_Systems.end(),
+                                       [](const ScheduledSystem& system) { return system.isRemoved; }),
+                        m_Systems.end());
+        m_HasRemovedSystems = false;
+    }
+
+    m_TickIndex++;
+}
+
+embU64 SystemScheduler::GetTickIndex() const noexcept
+{
+    return m_TickIndex;
+}
+
+embU32 SystemScheduler::GetSystemPeriodTicks(SystemId id) const noexcept
+{
+    for (const ScheduledSystem& system : m_Systems)
+    {
+        if (system.id == id && !system.isRemoved)
+            return system.periodTicks;
+    }
+    return 0;
+}
+
+embU32 SystemScheduler::GetSystemPhaseTicks(SystemId id) const noexcept
+{
+    for (const ScheduledSystem& system : m_Systems)
+    {
+        if (system.id == id && !system.isRemoved)
+            return system.phaseTicks;
+    }
+    return 0;
+}
+
+embF32 SystemScheduler::GetEffectiveSimRate() const noexcept
+{
+    return 1.f / EngineClock::Instance().GetFixedDT();
+}
+
+embU32 SystemScheduler::ComputePeriodTicks(embF32 rateHz) const noexcept
+{
+    if (rateHz > m_SimRate)
+    {
+        printf("Warning: Scheduled system rate %.1fHz is above the sim rate %.1fHz, running every tick instead\n",
+               rateHz, m_SimRate);
+        return 1;
+    }
+
+    return std::max(1u, (embU32)std::lround(m_SimRate / rateHz));
+}
+
+embU32 SystemScheduler::PickLeastBusyPhase(embU32 periodTicks) const noexcept
+{
+    // every-tick systems have nothing to pick.
+    if (periodTicks == 1)
+        return 0;
+
+    // Score each phase by the busiest slot it would land on, then by the total cost it would share.
+    embU32 bestPhase = 0;
+    embF32 bestPeak = embF32_MAX;
+    embF32 bestTotal = embF32_MAX;
+    for (embU32 phase = 0; phase < periodTicks; phase++)
+    {
+        embF32 peak = 0.f;
+        embF32 total = 0.f;
+        for (embU32 slot = phase % SCHEDULER_SLOT_COUNT; slot < SCHEDULER_SLOT_COUNT; slot += periodTicks)
+        {
+            peak = std::max(peak, m_SlotCost[slot]);
+            total += m_SlotCost[slot];
+        }
+
+        if (peak < bestPeak || (peak == bestPeak && total < bestTotal))
+        {
+            bestPhase = phase;
+            bestPeak = peak;
+            bestTotal = total;
+        }
+    }
+    return bestPhase;
+}
+
+void SystemScheduler::AddSlotCost(const ScheduledSystem& system, embF32 sign) noexcept
+{
+    // Note: periods that don't divide SCHEDULER_SLOT_COUNT wrap unevenly, good enough for staggering.
+    for (embU32 slot = system.phaseTicks % SCHEDULER_SLOT_COUNT; slot < SCHEDULER_SLOT_COUNT; slot += system.periodTicks)
+        m_SlotCost[slot] += sign * system.desc.costWeight;
+}
+
+void SystemScheduler::Rebuild() noexcept
+{
+    m_SimRate = GetEffectiveSimRate();
+    m_SlotCost.fill(0.f);
+
+    // fixed phases first, so auto phases stagger around them.
+    for (ScheduledSystem& system : m_Systems)
+    {
+        system.periodTicks = ComputePeriodTicks(system.desc.rateHz);
+        if (system.isAutoPhase)
+            continue;
+
+        system.phaseTicks = (embU32)system.desc.phaseTicks % system.periodTicks;
+        AddSlotCost(system, 1.f);
+    }
+
+    for (ScheduledSystem& system : m_Systems)
+    {
+        if (!system.isAutoPhase)
+            continue;
+
+        system.phaseTicks = PickLeastBusyPhase(system.periodTicks);
+        AddSlotCost(system, 1.f);
+    }
+}
+
+EMB_NAMESPACE_END
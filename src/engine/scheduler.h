@@ -0,0 +1,84 @@
+#pragma once
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/str.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Called at the system's own rate. dt is the sim time since the system last ran.
+using ScheduledSystemFunc = void (*)(embF32 dt, void* userData);
+
+struct ScheduledSystemDesc
+{
+    embStrView name; // for debugging. Must outlive the registration.
+    ScheduledSystemFunc func = nullptr;
+    void* userData = nullptr;
+    embF32 rateHz = 0.f; // how often to run in sim time. Rounded to a whole number of fixed ticks, capped at the sim rate.
+    embS32 phaseTicks = -1; // which tick in the period to run on. -1 picks the least busy one.
+    embF32 costWeight = 1.f; // rough relative cost, used to stagger expensive systems away from each other
+};
+
+// Runs systems at their own rates on top of EngineClock's fixed tick, e.g. physics every tick, AI at 10Hz,
+// streaming checks at 2Hz, without each system keeping its own accumulator.
+// Rates are snapped to whole fixed ticks so runs stay deterministic. Low-rate systems get phase offsets that spread
+// them over different ticks instead of all landing on the same one.
+// Ticked from Engine::FixedUpdate. Register/unregister from the thread running fixed updates.
+class SystemScheduler
+{
+  public:
+    using SystemId = embU32;
+    static constexpr SystemId INVALID_SYSTEM = 0;
+
+    EMB_CLASS_SERVICE_MACRO(SystemScheduler, SYSTEM_SCHEDULER)
+
+    SystemId Register(const ScheduledSystemDesc& desc) noexcept;
+    void Unregister(SystemId id) noexcept;
+
+    // Runs every system due on this fixed tick, in registration order. Call once per fixed tick.
+    void Tick() noexcept;
+
+    // Fixed ticks run since start.
+    embU64 GetTickIndex() const noexcept;
+    // How many fixed ticks between runs of a system. 0 if not registered.
+    embU32 GetSystemPeriodTicks(SystemId id) const noexcept;
+    // Which tick within its period the system runs on. 0 if not registered.
+    embU32 GetSystemPhaseTicks(SystemId id) const noexcept;
+
+  private:
+    struct ScheduledSystem
+    {
+        ScheduledSystemDesc desc;
+        SystemId id = INVALID_SYSTEM;
+        embU32 periodTicks = 1;
+        embU32 phaseTicks = 0;
+        embBool isAutoPhase = false;
+        embBool isRemoved = false; // unregistered during Tick, erased after it
+    };
+
+    // Fixed ticks per second of sim time actually being run, i.e. including the overload governor's rate divisor.
+    embF32 GetEffectiveSimRate() const noexcept;
+
+    // Converts a rate into fixed ticks at the current effective sim rate.
+    embU32 ComputePeriodTicks(embF32 rateHz) const noexcept;
+    // Picks the phase whose ticks carry the least cost from other systems.
+    embU32 PickLeastBusyPhase(embU32 periodTicks) const noexcept;
+    void AddSlotCost(const ScheduledSystem& system, embF32 sign) noexcept;
+    // Recomputes periods (and auto phases) for all systems, e.g. after the sim rate or rate divisor changed.
+    void Rebuild() noexcept;
+
+    // Cost landing on each tick, wrapped over SCHEDULER_SLOT_COUNT ticks. Used to stagger systems.
+    static constexpr embU32 SCHEDULER_SLOT_COUNT = 120; // divisible by most common periods
+    embFixedSizeArray<embF32, SCHEDULER_SLOT_COUNT> m_SlotCost {};
+
+    embArray<ScheduledSystem> m_Systems;
+    embU64 m_TickIndex = 0;
+    embF32 m_SimRate = 0.f; // effective sim rate the periods were computed with
+    embBool m_IsTicking = false;
+    embBool m_HasRemovedSystems = false;
+    SystemId m_NextSystemId = 1;
+};
+
+EMB_NAMESPACE_END
@@ -0,0 +1,49 @@
+#include "pch-engine.h"
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "services.h"
+
+EMB_NAMESPACE_START
+
+constinit EMB_THREAD_LOCAL ServiceRegistry* t_CurrentServiceRegistry = nullptr;
+
+ServiceRegistry::~ServiceRegistry() noexcept
+{
+    DestroyAll();
+
+    if (t_CurrentServiceRegistry == this)
+        t_CurrentServiceRegistry = nullptr;
+}
+
+void ServiceRegistry::DestroyAll() noexcept
+{
+    // Note: services can still reach earlier services from their destructors, those are destroyed after them.
+    while (!m_CreationOrder.empty())
+    {
+        const CreatedService created = m_CreationOrder.back();
+        created.destroy(m_Services[(embSizeT)created.id]);
+        m_Services[(embSizeT)created.id] = nullptr;
+        m_CreationOrder.pop_back();
+    }
+    m_CreationOrder.shrink_to_fit(); // nothing left allocated for the leak report after teardown
+}
+
+embBool ServiceRegistry::Has(EngineService id) const noexcept
+{
+    return m_Services[(embSizeT)id] != nullptr;
+}
+
+void ServiceRegistry::SetCurrent(ServiceRegistry* registry) noexcept
+{
+    t_CurrentServiceRegistry = registry;
+}
+
+ServiceRegistry* ServiceRegistry::GetCurrent() noexcept
+{
+    return t_CurrentServiceRegistry;
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/macros_util.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+//-------------------------------------------------------------------//
+//                                 Enum                              //
+//-------------------------------------------------------------------//
+
+// Every engine-wide service. A service is reached through ClassName::Instance(), backed by a slot in the ServiceRegistry
+// bound to the calling thread.
+#define X_LIST_ENGINESERVICE(X) \
+    X(EngineService, THREAD_MANAGER) \
+    X(EngineService, FRAME_ARENA) \
+    X(EngineService, JOB_SYSTEM) \
+    X(EngineService, MAIN_THREAD_QUEUE) \
+    X(EngineService, TASK_SCHEDULER) \
+    X(EngineService, ENGINE_CLOCK) \
+    X(EngineService, SIMULATION_THREAD) \
+    X(EngineService, TIMER_WHEEL) \
+    X(EngineService, SYSTEM_SCHEDULER) \
+    X(EngineService, FRAME_TASK_GRAPH) \
+    X(EngineService, RESOURCE_MANAGER) \
+    X(EngineService, WINDOW_MANAGER) \
+    X(EngineService, GRAPHICS) \
+    X(EngineService, ENGINE)
+
+EMB_X_DEF_ENUM(EngineService, embU8, X_LIST_ENGINESERVICE)
+EMB_X_DEF_ENUM_TO_STR(EngineService, X_LIST_ENGINESERVICE)
+
+#undef X_LIST_ENGINESERVICE
+
+//-------------------------------------------------------------------//
+//                          ServiceRegistry                          //
+//-------------------------------------------------------------------//
+
+// Owns one instance of each engine service, with explicit lifetimes: services are created in the order Create is called
+// and destroyed in reverse. One registry per engine instance, so several engines can live in one process (e.g. tests).
+// Each thread is bound to one registry. Threads spawned by services (job workers, sim thread) bind their parent's.
+// Lookups are a thread-local pointer plus an array index, no locks or init guards. Create/DestroyAll must not race
+// with other threads using the registry.
+class ServiceRegistry
+{
+  public:
+    ServiceRegistry() noexcept = default;
+    ~ServiceRegistry() noexcept;
+
+    ServiceRegistry(const ServiceRegistry&) = delete;
+    ServiceRegistry& operator=(const ServiceRegistry&) = delete;
+
+    // Constructs the service T. T must use EMB_CLASS_SERVICE_MACRO.
+    template<typename T>
+    T& Create() noexcept
+    {
+        const embSizeT slot = (embSizeT)T::SERVICE_ID;
+        EMB_ASSERT_HARD(m_Services[slot] == nullptr, "service created twice");
+
+        T* service = new T();
+        m_Services[slot] = service;
+        m_CreationOrder.push_back({T::SERVICE_ID, [](void* ptr) { delete (T*)ptr; }});
+        return *service;
+    }
+
+    // Destroys every service, last created first.
+    void DestroyAll() noexcept;
+
+    embBool Has(EngineService id) const noexcept;
+    void* Get(EngineService id) const noexcept
+    {
+        return m_Services[(embSizeT)id];
+    }
+
+    // Binds a registry to the calling thread. nullptr unbinds.
+    static void SetCurrent(ServiceRegistry* registry) noexcept;
+    static ServiceRegistry* GetCurrent() noexcept;
+
+  private:
+    struct CreatedService
+    {
+        EngineService id = EngineService::ENUM_COUNT;
+        void (*destroy)(void*) = nullptr;
+    };
+
+    embFixedSizeArray<void*, (embSizeT)EngineService::ENUM_COUNT> m_Services {};
+    embArray<CreatedService> m_CreationOrder;
+};
+
+// Registry bound to the calling thread. Read by every Instance() call, keep it trivial.
+extern constinit EMB_THREAD_LOCAL ServiceRegistry* t_CurrentServiceRegistry;
+
+// Shorthand for the service getter. Replaces EMB_CLASS_SINGLETON_MACRO for engine services.
+#define EMB_CLASS_SERVICE_MACRO(className, serviceId) \
+    static constexpr EngineService SERVICE_ID = EngineService::serviceId; \
+    static className& Instance() noexcept \
+    { \
+        EMB_ASSERT_HARD(t_CurrentServiceRegistry != nullptr && t_CurrentServiceRegistry->Has(SERVICE_ID), \
+                        "service used before creation, or thread not bound to a ServiceRegistry"); \
+        return *(className*)t_CurrentServiceRegistry->Get(SERVICE_ID); \
+    }
+
+EMB_NAMESPACE_END
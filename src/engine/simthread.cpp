@@ -0,0 +1,157 @@
+#include "pch-engine.h"
+
+#include <chrono>
+#include <thread>
+
+#include "util/macros.h"
+#include "util/types.h"
+
+#include "engine.h"
+#include "engineclock.h"
+#include "simthread.h"
+#include "threadmanager.h"
+
+EMB_NAMESPACE_START
+
+// If the sim thread falls behind by more than this many ticks, stop trying to catch up and skip ahead.
+constexpr embU32 SIMTHREAD_MAX_CATCHUP_TICKS = 2;
+// How long to nap while the sim is inactive or time is frozen.
+constexpr std::chrono::milliseconds SIMTHREAD_IDLE_SLEEP {1};
+
+static constinit EMB_THREAD_LOCAL embBool t_IsSimThread = false;
+
+SimState InterpolateSimState(const SimState& previous, const SimState& current, embF32 amount) noexcept
+{
+    SimState state = current;
+    state.simTime = previous.simTime + (current.simTime - previous.simTime) * (embF64)amount;
+    return state;
+}
+
+void SimulationThread::Start() noexcept
+{
+    if (m_IsRunning.load())
+        return;
+
+    // tick period and time scale are pushed in by EngineClock::SetSimulationThreaded.
+    m_TickCount.store(0);
+    m_LastTickEpoch.store(EngineClock::Clock::now().time_since_epoch().count());
+
+    m_IsRunning.store(true);
+    m_OwnsFixedUpdates.store(true);
+    m_Thread = std::thread(&SimulationThread::ThreadMain, this, ServiceRegistry::GetCurrent());
+}
+
+void SimulationThread::Stop() noexcept
+{
+    if (!m_IsRunning.exchange(false))
+        return;
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+    m_OwnsFixedUpdates.store(false); // only once the last tick is done
+}
+
+embBool SimulationThread::IsRunning() const noexcept
+{
+    return m_IsRunning.load(std::memory_order_relaxed);
+}
+
+void SimulationThread::SetActive(embBool active) noexcept
+{
+    m_IsActive.store(active, std::memory_order_relaxed);
+}
+
+void SimulationThread::SetTickPeriod(ClockDurationType tickPeriod) noexcept
+{
+    m_TickPeriod.store(tickPeriod, std::memory_order_relaxed);
+}
+
+void SimulationThread::SetTimeScale(embF32 timeScale) noexcept
+{
+    m_TimeScale.store(timeScale, std::memory_order_relaxed);
+}
+
+embU64 SimulationThread::GetTickCount() const noexcept
+{
+    return m_TickCount.load(std::memory_order_acquire);
+}
+
+SimulationThread::ClockDurationType SimulationThread::GetLastTickEpoch() const noexcept
+{
+    return m_LastTickEpoch.load(std::memory_order_acquire);
+}
+
+SimulationThread::ClockDurationType SimulationThread::GetScaledTickPeriod() const noexcept
+{
+    const embF32 timeScale = m_TimeScale.load(std::memory_order_relaxed);
+    if (timeScale <= 0.f)
+        return 0;
+    return (ClockDurationType)((embF32)m_TickPeriod.load(std::memory_order_relaxed) / timeScale);
+}
+
+SimulationThread::ClockDurationType SimulationThread::GetTickPeriod() const noexcept
+{
+    return m_TickPeriod.load(std::memory_order_relaxed);
+}
+
+const SimulationThread::StateSnapshot& SimulationThread::AcquireLatestState() noexcept
+{
+    m_AcquiredState = m_StateBuffer.AcquireLatest();
+    return m_AcquiredState;
+}
+
+const SimulationThread::StateSnapshot& SimulationThread::GetAcquiredState() const noexcept
+{
+    return m_AcquiredState;
+}
+
+embBool SimulationThread::IsFixedUpdateThread() const noexcept
+{
+    return t_IsSimThread == m_OwnsFixedUpdates.load(std::memory_order_relaxed);
+}
+
+void SimulationThread::ThreadMain(ServiceRegistry* services) noexcept
+{
+    using Clock = EngineClock::Clock;
+
+    ServiceRegistry::SetCurrent(services); // FixedUpdate reaches services through Instance()
+    t_IsSimThread = true;
+    ThreadManager::Instance().ApplyToCurrentThread(ThreadRole::SIMULATION);
+
+    ClockDurationType nextTickEpoch = Clock::now().time_since_epoch().count() + GetScaledTickPeriod();
+
+    while (m_IsRunning.load(std::memory_order_relaxed))
+    {
+        const ClockDurationType scaledPeriod = GetScaledTickPeriod();
+
+        // sim off or time frozen, idle and restart the cadence once it comes back.
+        if (!m_IsActive.load(std::memory_order_relaxed) || scaledPeriod <= 0)
+        {
+            std::this_thread::sleep_for(SIMTHREAD_IDLE_SLEEP);
+            nextTickEpoch = Clock::now().time_since_epoch().count() + scaledPeriod;
+            continue;
+        }
+
+        std::this_thread::sleep_until(Clock::time_point(Clock::duration(nextTickEpoch)));
+
+        Engine::Instance().FixedUpdate();
+
+        const ClockDurationType tickEndEpoch = Clock::now().time_since_epoch().count();
+        const embU64 tickCount = m_TickCount.load(std::memory_order_relaxed) + 1;
+        m_StateBuffer.Publish(Engine::Instance().GetSimState(), tickCount, tickEndEpoch);
+        m_LastTickEpoch.store(tickEndEpoch, std::memory_order_release);
+        m_TickCount.store(tickCount, std::memory_order_release);
+
+        nextTickEpoch += scaledPeriod;
+
+        // Ticks are taking longer than real time. Skip ahead instead of spiralling.
+        if (tickEndEpoch - nextTickEpoch > scaledPeriod * SIMTHREAD_MAX_CATCHUP_TICKS)
+        {
+            printf("Warning: Sim thread skipping %ld planned tick(s)\n",
+                   (tickEndEpoch - nextTickEpoch) / scaledPeriod);
+            nextTickEpoch = tickEndEpoch + scaledPeriod;
+        }
+    }
+}
+
+EMB_NAMESPACE_END
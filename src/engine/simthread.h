@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "engine/engineclock.h"
+#include "engine/services.h"
+#include "util/macros.h"
+#include "util/pingpongbuffer.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+//-------------------------------------------------------------------//
+//                              SimState                             //
+//-------------------------------------------------------------------//
+
+// What a fixed tick leaves behind for render. Render draws between the last two ticks (see Engine::GetRenderSimState).
+struct SimState
+{
+    embU64 tickIndex = 0; // fixed ticks run so far
+    embF64 simTime = 0.0; // sim seconds at the end of the tick
+};
+
+// previous and current blended by amount, 0 = previous and 1 = current.
+SimState InterpolateSimState(const SimState& previous, const SimState& current, embF32 amount) noexcept;
+
+//-------------------------------------------------------------------//
+//                           SimStateBuffer                          //
+//-------------------------------------------------------------------//
+
+// Hands simulation state from the sim thread to the render thread without either side waiting.
+// Each published snapshot carries the state before and after the tick so render can interpolate between them.
+// Snapshots are triple buffered (see PingPongBuffer), so the sim thread always has a free slot to write to.
+template<typename T>
+class SimStateBuffer
+{
+  public:
+    struct Snapshot
+    {
+        T previous {}; // state before the tick
+        T current {}; // state after the tick
+        embU64 tickIndex = 0;
+        EngineClock::ClockDurationType tickEpoch = 0; // real time point the tick finished at
+    };
+
+    // Sim thread only. Copies state into the back buffer and makes it the latest snapshot.
+    void Publish(const T& state, embU64 tickIndex, EngineClock::ClockDurationType tickEpoch) noexcept
+    {
+        Snapshot& back = m_Snapshots.GetWriteBuffer();
+        back.previous = m_LastPublished;
+        back.current = state;
+        back.tickIndex = tickIndex;
+        back.tickEpoch = tickEpoch;
+        m_LastPublished = state;
+        m_Snapshots.Publish();
+    }
+
+    // Render thread only. Returns the latest published snapshot. Stays valid until the next call.
+    const Snapshot& AcquireLatest() noexcept
+    {
+        return m_Snapshots.BeginRead();
+    }
+
+  private:
+    PingPongBuffer<Snapshot, 3> m_Snapshots;
+    T m_LastPublished {}; // sim thread only
+};
+
+//-------------------------------------------------------------------//
+//                          SimulationThread                         //
+//-------------------------------------------------------------------//
+
+// Opt-in dedicated thread that runs Engine::FixedUpdate at the target sim rate,
+// decoupled from Update/Render on the main thread.
+// Enable with EngineClock::SetSimulationThreaded, before Engine::Init or while running.
+//
+// While running, the sim thread owns what FixedUpdate ticks (TimerWheel, SystemScheduler, Engine's SimState), main
+// thread code must stay off them (asserted in debug, see IsFixedUpdateThread). Every tick publishes a SimState
+// snapshot, which Engine::Render picks up and interpolates. That snapshot is the only way sim results reach render.
+class SimulationThread
+{
+  public:
+    using ClockDurationType = EngineClock::ClockDurationType;
+    using StateSnapshot = SimStateBuffer<SimState>::Snapshot;
+
+    EMB_CLASS_SERVICE_MACRO(SimulationThread, SIMULATION_THREAD)
+
+    // Spawns the sim thread. Tick period and time scale are kept in sync by EngineClock.
+    void Start() noexcept;
+    // Signals the sim thread to stop and joins it. Blocks until the current tick is done.
+    void Stop() noexcept;
+    embBool IsRunning() const noexcept;
+
+    // Thread-safe. Sim thread only ticks while active.
+    void SetActive(embBool active) noexcept;
+    // Thread-safe. Tick period is in real time, before time scale is applied.
+    void SetTickPeriod(ClockDurationType tickPeriod) noexcept;
+    void SetTimeScale(embF32 timeScale) noexcept;
+
+    // Total number of ticks simulated since Start.
+    embU64 GetTickCount() const noexcept;
+    // Real time point (epoch) when the last tick finished.
+    ClockDurationType GetLastTickEpoch() const noexcept;
+    // Real time between ticks, time scale included.
+    ClockDurationType GetScaledTickPeriod() const noexcept;
+    // Sim time per tick. Any thread.
+    ClockDurationType GetTickPeriod() const noexcept;
+
+    // Main thread only. Takes the latest snapshot the sim thread published, kept until the next call.
+    const StateSnapshot& AcquireLatestState() noexcept;
+    // Main thread only. What the last AcquireLatestState returned.
+    const StateSnapshot& GetAcquiredState() const noexcept;
+
+    // True on the thread that runs fixed updates: the sim thread while it runs, any other thread otherwise.
+    embBool IsFixedUpdateThread() const noexcept;
+
+  private:
+    void ThreadMain(ServiceRegistry* services) noexcept;
+
+    std::thread m_Thread;
+    std::atomic<embBool> m_IsRunning = false;
+    std::atomic<embBool> m_OwnsFixedUpdates = false; // from Start until the thread is joined
+    std::atomic<embBool> m_IsActive = false;
+    std::atomic<ClockDurationType> m_TickPeriod = 0;
+    std::atomic<embF32> m_TimeScale = 1.0f;
+
+    std::atomic<embU64> m_TickCount = 0;
+    std::atomic<ClockDurationType> m_LastTickEpoch = 0;
+
+    SimStateBuffer<SimState> m_StateBuffer;
+    StateSnapshot m_AcquiredState; // main thread only
+};
+
+EMB_NAMESPACE_END
@@ -0,0 +1,218 @@
+#include "pch-engine.h"
+
+#include <bit>
+#include <cstdio>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "jobsystem.h"
+#include "mainthreadqueue.h"
+#include "task.h"
+
+EMB_NAMESPACE_START
+
+//-------------------------------------------------------------------//
+//                         CoroutineFramePool                        //
+//-------------------------------------------------------------------//
+
+namespace
+{
+constexpr embSizeT FRAME_MIN_SIZE_SHIFT = 7; // 128B
+constexpr embSizeT FRAME_SIZE_CLASS_COUNT = 6; // up to 4KB
+constexpr embSizeT FRAME_MAX_SIZE = (embSizeT)1 << (FRAME_MIN_SIZE_SHIFT + FRAME_SIZE_CLASS_COUNT - 1);
+
+struct FreeFrame
+{
+    FreeFrame* next;
+};
+
+struct FrameSizeClass
+{
+    std::mutex mutex;
+    FreeFrame* head = nullptr;
+};
+
+// Never freed, frames can outlive every engine instance.
+FrameSizeClass s_FrameSizeClasses[FRAME_SIZE_CLASS_COUNT];
+
+embSizeT GetFrameSizeClass(embSizeT size) noexcept
+{
+    const embSizeT shift = std::bit_width(std::max<embSizeT>(size, 1) - 1);
+    return shift <= FRAME_MIN_SIZE_SHIFT ? 0 : shift - FRAME_MIN_SIZE_SHIFT;
+}
+} // namespace
+
+void* CoroutineFramePool::Allocate(embSizeT size) noexcept
+{
+    if (size > FRAME_MAX_SIZE)
+        return ::operator new(size);
+
+    const embSizeT sizeClass = GetFrameSizeClass(size);
+    FrameSizeClass& frames = s_FrameSizeClasses[sizeClass];
+    {
+        std::lock_guard lock(frames.mutex);
+        if (frames.head != nullptr)
+        {
+            FreeFrame* frame = frames.head;
+            frames.head = frame->next;
+            return frame;
+        }
+    }
+
+    return ::operator new((embSizeT)1 << (FRAME_MIN_SIZE_SHIFT + sizeClass));
+}
+
+void CoroutineFramePool::Free(void* ptr, embSizeT size) noexcept
+{
+    if (size > FRAME_MAX_SIZE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FrameSizeClass& frames = s_FrameSizeClasses[GetFrameSizeClass(size)];
+    FreeFrame* frame = (FreeFrame*)ptr;
+
+    std::lock_guard lock(frames.mutex);
+    frame->next = frames.head;
+    frames.head = frame;
+}
+
+//-------------------------------------------------------------------//
+//                           TaskScheduler                           //
+//-------------------------------------------------------------------//
+
+TaskScheduler::~TaskScheduler() noexcept
+{
+    // Suspended tasks may be mid-way through an awaited chain, destroying them from here isn't safe. Leak and tell.
+    const embU32 activeCount = GetActiveTaskCount();
+    if (activeCount > 0)
+        printf("Warning: %u spawned task(s) never finished, leaking their frames\n", activeCount);
+}
+
+void TaskScheduler::Spawn(Task<void> task) noexcept
+{
+    EMB_ASSERT_HARD(task.IsValid(), "spawning an empty Task");
+
+    const Task<void>::Handle handle = task.Release();
+    handle.promise().m_IsDetached = true;
+    m_ActiveTaskCount.fetch_add(1, std::memory_order_relaxed);
+    handle.resume();
+}
+
+void TaskScheduler::OnSpawnedTaskDone() noexcept
+{
+    m_ActiveTaskCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+embU32 TaskScheduler::GetActiveTaskCount() const noexcept
+{
+    return m_ActiveTaskCount.load(std::memory_order_relaxed);
+}
+
+void TaskScheduler::ResumeAll(std::mutex& mutex, embLargeArray<std::coroutine_handle<>>& waiters,
+                              embLargeArray<std::coroutine_handle<>>& scratch) noexcept
+{
+    // swap out first, resumed tasks may wait again and that should land on the next round.
+    {
+        std::lock_guard lock(mutex);
+        scratch.swap(waiters);
+    }
+
+    for (const std::coroutine_handle<> handle : scratch)
+        handle.resume();
+    scratch.clear();
+}
+
+void TaskScheduler::RunFrame() noexcept
+{
+    ResumeAll(m_FrameMutex, m_NextFrameWaiters, m_FrameScratch);
+
+    {
+        std::lock_guard lock(m_FrameMutex);
+        m_CounterScratch.swap(m_CounterWaiters);
+    }
+
+    for (const CounterWaiter& waiter : m_CounterScratch)
+    {
+        if (waiter.counter->IsDone())
+        {
+            waiter.handle.resume();
+            continue;
+        }
+
+        std::lock_guard lock(m_FrameMutex);
+        m_CounterWaiters.push_back(waiter);
+    }
+    m_CounterScratch.clear();
+}
+
+void TaskScheduler::RunFixedTick() noexcept
+{
+    ResumeAll(m_FixedTickMutex, m_NextFixedTickWaiters, m_FixedTickScratch);
+}
+
+void TaskScheduler::ResumeOnMainThread(std::coroutine_handle<> handle) noexcept
+{
+    if (MainThreadQueue::Instance().Post([handle] { handle.resume(); }))
+        return;
+
+    // queue full, next frame is late but still correct.
+    AddNextFrameWaiter(handle);
+}
+
+void TaskScheduler::AddNextFrameWaiter(std::coroutine_handle<> handle) noexcept
+{
+    std::lock_guard lock(m_FrameMutex);
+    m_NextFrameWaiters.push_back(handle);
+}
+
+void TaskScheduler::AddNextFixedTickWaiter(std::coroutine_handle<> handle) noexcept
+{
+    std::lock_guard lock(m_FixedTickMutex);
+    m_NextFixedTickWaiters.push_back(handle);
+}
+
+void TaskScheduler::AddJobCounterWaiter(std::coroutine_handle<> handle, const JobCounter& counter) noexcept
+{
+    std::lock_guard lock(m_FrameMutex);
+    m_CounterWaiters.push_back({handle, &counter});
+}
+
+//-------------------------------------------------------------------//
+//                             Awaitables                            //
+//-------------------------------------------------------------------//
+
+void ReadFileAwaiter::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    handle = awaiting;
+    JobSystem::Instance().Run(
+        [](void* self) {
+            ReadFileAwaiter& awaiter = *(ReadFileAwaiter*)self;
+
+            FILE* file = fopen(awaiter.path.c_str(), "rb");
+            if (file != nullptr)
+            {
+                fseek(file, 0, SEEK_END);
+                const long size = ftell(file);
+                fseek(file, 0, SEEK_SET);
+
+                if (size >= 0)
+                {
+                    awaiter.result.data.resize((embSizeT)size);
+                    awaiter.result.isSuccess = fread(awaiter.result.data.data(), 1, (embSizeT)size, file) == (embSizeT)size;
+                }
+                fclose(file);
+            }
+
+            if (!awaiter.result.isSuccess)
+                printf("Warning: ReadFile failed to read %s\n", awaiter.path.c_str());
+
+            TaskScheduler::Instance().ResumeOnMainThread(awaiter.handle);
+        },
+        this);
+}
+
+EMB_NAMESPACE_END
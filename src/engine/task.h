@@ -0,0 +1,424 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "engine/jobsystem.h"
+#include "engine/mainthreadqueue.h"
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/str.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Coroutines for multi-step async work, e.g. a load pipeline written top to bottom:
+//
+//   Task<void> LoadTexture(embStr path)
+//   {
+//       FileReadResult file = co_await ReadFile(path);         // read on a worker, back on the main thread
+//       DecodedImage image;
+//       co_await RunJob([&] { image = Decode(file.data); });   // decode on a worker, back on the main thread
+//       Upload(image);                                         // GL, main thread
+//   }
+//   TaskScheduler::Instance().Spawn(LoadTexture("..."));
+//
+// Tasks are lazy: they start when awaited or spawned. Frames come from CoroutineFramePool, not the global heap.
+// Every awaitable here except NextFixedTick resumes the task on the main thread.
+
+//-------------------------------------------------------------------//
+//                         CoroutineFramePool                        //
+//-------------------------------------------------------------------//
+
+// Recycles coroutine frames by size class (power of two, 128B to 4KB). Bigger frames fall back to the heap.
+// Process-wide, any thread.
+class CoroutineFramePool
+{
+  public:
+    static void* Allocate(embSizeT size) noexcept;
+    static void Free(void* ptr, embSizeT size) noexcept;
+};
+
+//-------------------------------------------------------------------//
+//                                Task                               //
+//-------------------------------------------------------------------//
+
+template<typename T>
+class Task;
+
+class TaskPromiseBase
+{
+  public:
+    // Resumes whoever awaited the task, or frees the frame of a spawned task.
+    struct FinalAwaiter
+    {
+        embBool await_ready() const noexcept
+        {
+            return false;
+        }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+    void unhandled_exception() const noexcept
+    {
+        std::abort(); // exceptions are off, never reached
+    }
+
+    static void* operator new(std::size_t size)
+    {
+        return CoroutineFramePool::Allocate(size);
+    }
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        CoroutineFramePool::Free(ptr, size);
+    }
+
+  protected:
+    friend class TaskScheduler;
+    template<typename T>
+    friend class Task;
+
+    std::coroutine_handle<> m_Continuation = nullptr;
+    embBool m_IsDetached = false; // spawned, nobody owns the Task object
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase
+{
+  public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value) noexcept
+    {
+        m_Value.emplace(std::forward<U>(value));
+    }
+
+    T TakeValue() noexcept
+    {
+        return std::move(*m_Value);
+    }
+
+  private:
+    std::optional<T> m_Value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+  public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+    void TakeValue() const noexcept {}
+};
+
+// Coroutine return type. Owns the frame until it finishes or gets spawned. co_await it from another task to run it and
+// get its result; the awaiting task continues on whatever thread the awaited one finished on.
+template<typename T = void>
+class Task
+{
+  public:
+    using promise_type = TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() noexcept = default;
+    explicit Task(Handle handle) noexcept : m_Handle(handle) {}
+    Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_Handle = std::exchange(other.m_Handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() noexcept
+    {
+        Reset();
+    }
+
+    embBool IsValid() const noexcept
+    {
+        return m_Handle != nullptr;
+    }
+    embBool IsDone() const noexcept
+    {
+        return m_Handle != nullptr && m_Handle.done();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            embBool await_ready() const noexcept
+            {
+                return false;
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().m_Continuation = awaiting;
+                return handle; // start the awaited task right away
+            }
+            T await_resume() noexcept
+            {
+                return handle.promise().TakeValue();
+            }
+        };
+
+        EMB_ASSERT_HARD(m_Handle != nullptr, "awaiting an empty Task");
+        return Awaiter {m_Handle};
+    }
+
+  private:
+    friend class TaskScheduler;
+
+    // Gives up ownership of the frame.
+    Handle Release() noexcept
+    {
+        return std::exchange(m_Handle, nullptr);
+    }
+
+    void Reset() noexcept
+    {
+        if (m_Handle != nullptr)
+            m_Handle.destroy();
+        m_Handle = nullptr;
+    }
+
+    Handle m_Handle = nullptr;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+//-------------------------------------------------------------------//
+//                           TaskScheduler                           //
+//-------------------------------------------------------------------//
+
+// Owns spawned tasks and resumes the ones waiting on the frame loop.
+// Engine::Update resumes NextFrame waiters, Engine::FixedUpdate resumes NextFixedTick waiters (on the sim thread if the
+// sim is threaded). Job and file awaitables resume through the MainThreadQueue.
+class TaskScheduler
+{
+  public:
+    EMB_CLASS_SERVICE_MACRO(TaskScheduler, TASK_SCHEDULER)
+
+    // Any thread. Starts task on the calling thread (up to its first co_await) and keeps it alive until it finishes.
+    void Spawn(Task<void> task) noexcept;
+
+    // Main thread only. Resumes tasks waiting for the next frame, and the ones whose JobCounter is done.
+    void RunFrame() noexcept;
+    // Thread running fixed updates only. Resumes tasks waiting for the next fixed tick.
+    void RunFixedTick() noexcept;
+
+    // Spawned tasks that haven't finished.
+    embU32 GetActiveTaskCount() const noexcept;
+
+    // Any thread. Queues handle to be resumed on the main thread, as soon as possible.
+    void ResumeOnMainThread(std::coroutine_handle<> handle) noexcept;
+
+    // Used by the awaitables below.
+    void AddNextFrameWaiter(std::coroutine_handle<> handle) noexcept;
+    void AddNextFixedTickWaiter(std::coroutine_handle<> handle) noexcept;
+    void AddJobCounterWaiter(std::coroutine_handle<> handle, const JobCounter& counter) noexcept;
+
+    // Called by a spawned task's final suspend.
+    void OnSpawnedTaskDone() noexcept;
+
+    ~TaskScheduler() noexcept;
+
+  private:
+    struct CounterWaiter
+    {
+        std::coroutine_handle<> handle;
+        const JobCounter* counter = nullptr;
+    };
+
+    // resumes the handles in waiters, emptying it. scratch avoids reallocating every frame.
+    static void ResumeAll(std::mutex& mutex, embLargeArray<std::coroutine_handle<>>& waiters,
+                          embLargeArray<std::coroutine_handle<>>& scratch) noexcept;
+
+    std::atomic<embU32> m_ActiveTaskCount = 0;
+
+    std::mutex m_FrameMutex;
+    embLargeArray<std::coroutine_handle<>> m_NextFrameWaiters;
+    embLargeArray<std::coroutine_handle<>> m_FrameScratch;
+    embLargeArray<CounterWaiter> m_CounterWaiters;
+    embLargeArray<CounterWaiter> m_CounterScratch;
+
+    std::mutex m_FixedTickMutex;
+    embLargeArray<std::coroutine_handle<>> m_NextFixedTickWaiters;
+    embLargeArray<std::coroutine_handle<>> m_FixedTickScratch;
+};
+
+template<typename Promise>
+std::coroutine_handle<> TaskPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+{
+    TaskPromiseBase& promise = handle.promise();
+    if (promise.m_Continuation != nullptr)
+        return promise.m_Continuation;
+
+    if (promise.m_IsDetached)
+    {
+        handle.destroy(); // fine, the coroutine is suspended at its final point
+        TaskScheduler::Instance().OnSpawnedTaskDone();
+    }
+    return std::noop_coroutine();
+}
+
+//-------------------------------------------------------------------//
+//                             Awaitables                            //
+//-------------------------------------------------------------------//
+
+// co_await NextFrame(): continue next Engine::Update, on the main thread.
+struct NextFrameAwaiter
+{
+    embBool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) const noexcept
+    {
+        TaskScheduler::Instance().AddNextFrameWaiter(handle);
+    }
+    void await_resume() const noexcept {}
+};
+
+inline NextFrameAwaiter NextFrame() noexcept
+{
+    return {};
+}
+
+// co_await NextFixedTick(): continue on the next Engine::FixedUpdate, on the thread running fixed updates.
+struct NextFixedTickAwaiter
+{
+    embBool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) const noexcept
+    {
+        TaskScheduler::Instance().AddNextFixedTickWaiter(handle);
+    }
+    void await_resume() const noexcept {}
+};
+
+inline NextFixedTickAwaiter NextFixedTick() noexcept
+{
+    return {};
+}
+
+// co_await RunJob(func): runs func() as a job on a worker, then continues on the main thread.
+template<typename F>
+struct RunJobAwaiter
+{
+    F func;
+    std::coroutine_handle<> handle = nullptr;
+
+    embBool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        // the awaiter lives in the suspended frame, safe to hand out until resumed.
+        handle = awaiting;
+        JobSystem::Instance().Run(
+            [](void* self) {
+                RunJobAwaiter& awaiter = *(RunJobAwaiter*)self;
+                awaiter.func();
+                TaskScheduler::Instance().ResumeOnMainThread(awaiter.handle);
+            },
+            this);
+    }
+    void await_resume() const noexcept {}
+};
+
+template<typename F>
+RunJobAwaiter<std::decay_t<F>> RunJob(F&& func) noexcept
+{
+    return {std::forward<F>(func)};
+}
+
+// co_await WaitForJobs(counter): continues on the main thread, the first frame after counter is done.
+struct JobCounterAwaiter
+{
+    const JobCounter& counter;
+
+    embBool await_ready() const noexcept
+    {
+        return counter.IsDone();
+    }
+    void await_suspend(std::coroutine_handle<> handle) const noexcept
+    {
+        TaskScheduler::Instance().AddJobCounterWaiter(handle, counter);
+    }
+    void await_resume() const noexcept {}
+};
+
+inline JobCounterAwaiter WaitForJobs(const JobCounter& counter) noexcept
+{
+    return {counter};
+}
+
+struct FileReadResult
+{
+    embBool isSuccess = false;
+    embLargeArray<embU8> data;
+};
+
+// co_await ReadFile(path): reads the whole file on a worker, then continues on the main thread.
+struct ReadFileAwaiter
+{
+    embStr path;
+    FileReadResult result;
+    std::coroutine_handle<> handle = nullptr;
+
+    embBool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    FileReadResult await_resume() noexcept
+    {
+        return std::move(result);
+    }
+};
+
+inline ReadFileAwaiter ReadFile(embStrView path) noexcept
+{
+    return {embStr(path), {}, nullptr};
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,153 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "threadmanager.h"
+
+#ifdef EMB_DEF_LINUX
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/resource.h>
+#    include <unistd.h>
+#elif defined(EMB_DEF_WINDOWS)
+#    include <windows.h>
+#endif
+
+EMB_NAMESPACE_START
+
+namespace
+{
+constexpr embU32 MAX_AFFINITY_CORES = 64; // one embU64 mask
+
+constexpr const char* THREAD_ROLE_NAMES[] = {"emb-main", "emb-render", "emb-audio", "emb-sim", "emb-worker"};
+EMB_ASSERT_STATIC(std::size(THREAD_ROLE_NAMES) == (embSizeT)ThreadRole::ENUM_COUNT, "missing thread role name");
+
+std::atomic<embBool> s_HasWarnedPriority = false;
+std::atomic<embBool> s_HasWarnedAffinity = false;
+
+void WarnOnce(std::atomic<embBool>& hasWarned, const char* message, const char* threadName) noexcept
+{
+    if (!hasWarned.exchange(true, std::memory_order_relaxed))
+        printf("Warning: %s (thread %s), further failures are not reported\n", message, threadName);
+}
+
+#ifdef EMB_DEF_LINUX
+// Lowest nice value RLIMIT_NICE lets this process set without CAP_SYS_NICE. Raising priority is always allowed up to it.
+int GetNiceFloor() noexcept
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NICE, &limit) != 0)
+        return 0;
+    if (limit.rlim_cur == RLIM_INFINITY)
+        return -20;
+    return std::clamp(20 - (int)limit.rlim_cur, -20, 0); // never clamp a request below normal priority
+}
+#endif
+} // namespace
+
+void ThreadManager::SetPlacementConfig(const ThreadPlacementConfig& config) noexcept
+{
+    m_Config = config;
+}
+
+const ThreadPlacementConfig& ThreadManager::GetPlacementConfig() const noexcept
+{
+    return m_Config;
+}
+
+ThreadDesc ThreadManager::GetThreadDesc(ThreadRole role, embU32 index) const noexcept
+{
+    ThreadDesc desc;
+    desc.name = THREAD_ROLE_NAMES[(embSizeT)role];
+    if (role == ThreadRole::WORKER)
+        desc.name += "-" + std::to_string(index);
+    desc.priority = m_Config.priorities[(embSizeT)role];
+
+    if (!m_Config.isPinningEnabled)
+        return desc;
+
+    const embU32 coreCount = GetCoreCount();
+    const embU64 allCores = coreCount >= MAX_AFFINITY_CORES ? ~0ull : (1ull << coreCount) - 1;
+
+    // hand out reserved cores from core 0 up, in role order.
+    embU64 roleCores = 0;
+    embU64 reservedCores = 0;
+    embU32 nextCore = 0;
+    for (embU32 i = 0; i < (embU32)ThreadRole::WORKER; i++)
+    {
+        for (embU32 j = 0; j < m_Config.reservedCoreCounts[i] && nextCore < coreCount; j++, nextCore++)
+        {
+            reservedCores |= 1ull << nextCore;
+            if (i == (embU32)role)
+                roleCores |= 1ull << nextCore;
+        }
+    }
+
+    // reserving every core leaves nothing for the rest, let them float instead.
+    const embU64 sharedCores = (allCores & ~reservedCores) != 0 ? allCores & ~reservedCores : allCores;
+    desc.affinityMask = roleCores != 0 ? roleCores : sharedCores;
+    return desc;
+}
+
+void ThreadManager::ApplyToCurrentThread(ThreadRole role, embU32 index) const noexcept
+{
+    ApplyThreadDesc(GetThreadDesc(role, index));
+}
+
+embU32 ThreadManager::GetCoreCount() noexcept
+{
+    return std::clamp(std::thread::hardware_concurrency(), 1u, MAX_AFFINITY_CORES);
+}
+
+void ThreadManager::ApplyThreadDesc(const ThreadDesc& desc) noexcept
+{
+#ifdef EMB_DEF_LINUX
+    // 16 bytes max including the terminator, longer names fail outright.
+    const embStr shortName = desc.name.substr(0, 15);
+    pthread_setname_np(pthread_self(), shortName.c_str());
+
+    // Linux applies nice values per thread. Going below 0 needs CAP_SYS_NICE or RLIMIT_NICE, without the capability
+    // HIGH and up get clamped to what the rlimit allows instead of failing.
+    constexpr int NICE_VALUES[] = {5, 0, -5, -10};
+    EMB_ASSERT_STATIC(std::size(NICE_VALUES) == (embSizeT)ThreadPriority::ENUM_COUNT, "missing nice value");
+    const int nice = NICE_VALUES[(embSizeT)desc.priority];
+    if (setpriority(PRIO_PROCESS, (id_t)gettid(), nice) != 0
+        && (nice >= GetNiceFloor() || setpriority(PRIO_PROCESS, (id_t)gettid(), GetNiceFloor()) != 0))
+        WarnOnce(s_HasWarnedPriority, "Could not set thread priority", shortName.c_str());
+
+    if (desc.affinityMask != 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (embU32 core = 0; core < MAX_AFFINITY_CORES; core++)
+        {
+            if (desc.affinityMask & (1ull << core))
+                CPU_SET(core, &cpuSet);
+        }
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+            WarnOnce(s_HasWarnedAffinity, "Could not set thread affinity", shortName.c_str());
+    }
+#elif defined(EMB_DEF_WINDOWS)
+    const std::wstring wideName(desc.name.begin(), desc.name.end()); // names are ASCII
+    SetThreadDescription(GetCurrentThread(), wideName.c_str());
+
+    constexpr int PRIORITY_VALUES[] = {THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL,
+                                       THREAD_PRIORITY_HIGHEST};
+    EMB_ASSERT_STATIC(std::size(PRIORITY_VALUES) == (embSizeT)ThreadPriority::ENUM_COUNT, "missing priority value");
+    if (!SetThreadPriority(GetCurrentThread(), PRIORITY_VALUES[(embSizeT)desc.priority]))
+        WarnOnce(s_HasWarnedPriority, "Could not set thread priority", desc.name.c_str());
+
+    if (desc.affinityMask != 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)desc.affinityMask) == 0)
+        WarnOnce(s_HasWarnedAffinity, "Could not set thread affinity", desc.name.c_str());
+#endif
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/macros_util.h"
+#include "util/str.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+//-------------------------------------------------------------------//
+//                                 Enum                              //
+//-------------------------------------------------------------------//
+
+// What an engine thread is for. Decides its default priority and which cores it may run on.
+#define X_LIST_THREADROLE(X) \
+    X(ThreadRole, MAIN) \
+    X(ThreadRole, RENDER) \
+    X(ThreadRole, AUDIO) \
+    X(ThreadRole, SIMULATION) \
+    X(ThreadRole, WORKER)
+
+EMB_X_DEF_ENUM(ThreadRole, embU8, X_LIST_THREADROLE)
+EMB_X_DEF_ENUM_TO_STR(ThreadRole, X_LIST_THREADROLE)
+
+#undef X_LIST_THREADROLE
+
+enum class ThreadPriority : embU8
+{
+    LOW, // background work that shouldn't compete with the frame
+    NORMAL,
+    HIGH, // frame-critical: main, render, sim
+    CRITICAL, // latency-critical: audio
+    ENUM_COUNT
+};
+
+// Everything the OS gets told about an engine thread.
+struct ThreadDesc
+{
+    embStr name; // shows up in profilers/debuggers. Linux cuts it to 15 chars.
+    ThreadPriority priority = ThreadPriority::NORMAL;
+    embU64 affinityMask = 0; // bit per logical core. 0 = let the OS decide.
+};
+
+struct ThreadPlacementConfig
+{
+    // Off: threads only get named and prioritized, the OS places them wherever.
+    embBool isPinningEnabled = false;
+    // Cores set aside for one role each, handed out from core 0 up in role order (MAIN, RENDER, AUDIO, SIMULATION).
+    // A reserved core only runs its role's thread, keeping workers (and their jitter) off it.
+    // Roles with 0 reserved cores, and all workers, share the cores left over.
+    embFixedSizeArray<embU32, (embSizeT)ThreadRole::ENUM_COUNT> reservedCoreCounts {1, 0, 0, 0, 0};
+    // Opt-in, e.g. HIGH for MAIN/RENDER/SIMULATION and CRITICAL for AUDIO. Raising priority usually needs permissions
+    // (Linux: CAP_SYS_NICE or RLIMIT_NICE), without them threads get the closest priority allowed.
+    embFixedSizeArray<ThreadPriority, (embSizeT)ThreadRole::ENUM_COUNT> priorities {
+        ThreadPriority::NORMAL, ThreadPriority::NORMAL, ThreadPriority::NORMAL, ThreadPriority::NORMAL, ThreadPriority::NORMAL};
+};
+
+//-------------------------------------------------------------------//
+//                           ThreadManager                           //
+//-------------------------------------------------------------------//
+
+// Names, prioritizes and pins engine threads. Each engine thread applies its own desc when it starts
+// (ApplyToCurrentThread), so the config has to be set before Engine::Init spawns anything.
+class ThreadManager
+{
+  public:
+    EMB_CLASS_SERVICE_MACRO(ThreadManager, THREAD_MANAGER)
+
+    // Set before Engine::Init. Cores that don't exist on this machine are ignored.
+    void SetPlacementConfig(const ThreadPlacementConfig& config) noexcept;
+    const ThreadPlacementConfig& GetPlacementConfig() const noexcept;
+
+    // Desc for the index'th thread of a role, e.g. worker 3 is "emb-worker-3".
+    ThreadDesc GetThreadDesc(ThreadRole role, embU32 index = 0) const noexcept;
+    // Applies GetThreadDesc(role, index) to the calling thread.
+    void ApplyToCurrentThread(ThreadRole role, embU32 index = 0) const noexcept;
+
+    // Logical cores usable by the affinity masks (capped at 64).
+    static embU32 GetCoreCount() noexcept;
+    // Names, prioritizes and pins the calling thread. Failures (e.g. no permission to raise priority) are warned once.
+    static void ApplyThreadDesc(const ThreadDesc& desc) noexcept;
+
+  private:
+    ThreadPlacementConfig m_Config;
+};
+
+EMB_NAMESPACE_END
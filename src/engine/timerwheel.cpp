@@ -0,0 +1,262 @@
+#include "pch-engine.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "util/macros.h"
+#include "util/macros_debug.h"
+#include "util/types.h"
+
+#include "engineclock.h"
+#include "simthread.h"
+#include "timerwheel.h"
+
+EMB_NAMESPACE_START
+
+TimerWheel::TimerWheel() noexcept
+{
+    m_ListHeads.fill(NO_NODE);
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleTicks(embU32 delayTicks, TimerFunc func, void* userData, embU32 intervalTicks) noexcept
+{
+    // m_CurrentTick is the next tick to run, so a delay of 1 fires on it.
+    return Schedule(m_CurrentTick + std::max(delayTicks, 1u) - 1, func, userData, intervalTicks, 0.f);
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleSeconds(embF32 delaySeconds, TimerFunc func, void* userData, embF32 intervalSeconds) noexcept
+{
+    const embU32 intervalTicks = intervalSeconds > 0.f ? SecondsToTicks(intervalSeconds) : 0;
+    return Schedule(m_CurrentTick + SecondsToTicks(delaySeconds) - 1, func, userData, intervalTicks, intervalSeconds);
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(embU64 expireTick, TimerFunc func, void* userData, embU32 intervalTicks, embF32 intervalSeconds) noexcept
+{
+    EMB_ASSERT_HARD(func != nullptr, "cannot schedule a timer without a function");
+    EMB_ASSERT_HARD(SimulationThread::Instance().IsFixedUpdateThread(), "TimerWheel used off the thread running fixed updates");
+
+    const embU32 index = AllocNode();
+    TimerNode& node = m_Nodes[index];
+    node.func = func;
+    node.userData = userData;
+    node.expireTick = expireTick;
+    node.intervalTicks = intervalTicks;
+    node.intervalSeconds = intervalSeconds;
+    node.state = TimerState::SCHEDULED;
+
+    Place(index);
+    m_ActiveCount++;
+    return ((TimerId)node.generation << 32) | index;
+}
+
+void TimerWheel::Cancel(TimerId id) noexcept
+{
+    EMB_ASSERT_HARD(SimulationThread::Instance().IsFixedUpdateThread(), "TimerWheel used off the thread running fixed updates");
+    const embU32 index = FindNode(id);
+    if (index == NO_NODE)
+        return;
+
+    TimerNode& node = m_Nodes[index];
+    if (node.state == TimerState::SCHEDULED)
+    {
+        Unlink(index);
+        FreeNode(index);
+    }
+    else if (node.state == TimerState::FIRING)
+    {
+        // still referenced by the batch, Tick frees it.
+        node.state = TimerState::CANCELLED;
+    }
+    else
+    {
+        return;
+    }
+
+    m_ActiveCount--;
+}
+
+embBool TimerWheel::IsScheduled(TimerId id) const noexcept
+{
+    const embU32 index = FindNode(id);
+    return index != NO_NODE && (m_Nodes[index].state == TimerState::SCHEDULED || m_Nodes[index].state == TimerState::FIRING);
+}
+
+void TimerWheel::Tick() noexcept
+{
+    const embU64 tick = m_CurrentTick;
+
+    // When the low bits of the tick wrap, the next slot of the level above comes into range and moves down.
+    // Highest first, so nodes can fall through several levels in one tick.
+    if ((tick & 0xFFFFFFFFull) == 0 && tick != 0)
+        Cascade(OVERFLOW_LIST);
+    for (embU32 level = LEVEL_COUNT - 1; level > 0; level--)
+    {
+        const embU32 shift = level * LEVEL_BITS;
+        if ((tick & ((1ull << shift) - 1)) != 0)
+            continue;
+
+        Cascade(level * SLOTS_PER_LEVEL + (embU32)((tick >> shift) & (SLOTS_PER_LEVEL - 1)));
+    }
+
+    // Everything in the level 0 slot expires on this tick. Detach it all up front, so handlers that schedule new
+    // timers can't touch the list being walked.
+    m_Batch.clear();
+    const embU32 list = (embU32)(tick & (SLOTS_PER_LEVEL - 1));
+    for (embU32 index = m_ListHeads[list]; index != NO_NODE; index = m_Nodes[index].next)
+    {
+        m_Nodes[index].state = TimerState::FIRING;
+        m_Batch.push_back(index);
+    }
+    m_ListHeads[list] = NO_NODE;
+
+    m_CurrentTick++;
+
+    // Group by handler so runs of the same code stay hot in cache. Index as tie break to keep the order deterministic.
+    std::sort(m_Batch.begin(), m_Batch.end(), [this](embU32 a, embU32 b) {
+        const TimerFunc funcA = m_Nodes[a].func;
+        const TimerFunc funcB = m_Nodes[b].func;
+        if (funcA != funcB)
+            return std::less<TimerFunc> {}(funcA, funcB);
+        return a < b;
+    });
+
+    m_LastTickFiredCount = 0;
+    for (const embU32 index : m_Batch)
+    {
+        // Note: handlers may grow m_Nodes, don't hold references across the call.
+        if (m_Nodes[index].state == TimerState::CANCELLED)
+            continue;
+
+        m_Nodes[index].func(m_Nodes[index].userData);
+        m_LastTickFiredCount++;
+    }
+
+    for (const embU32 index : m_Batch)
+    {
+        TimerNode& node = m_Nodes[index];
+        if (node.state == TimerState::FIRING && node.intervalTicks != 0)
+        {
+            if (node.intervalSeconds > 0.f)
+                node.intervalTicks = SecondsToTicks(node.intervalSeconds);
+
+            node.expireTick = tick + node.intervalTicks;
+            node.state = TimerState::SCHEDULED;
+            Place(index);
+            continue;
+        }
+
+        if (node.state == TimerState::FIRING)
+            m_ActiveCount--;
+        FreeNode(index);
+    }
+}
+
+embU64 TimerWheel::GetCurrentTick() const noexcept
+{
+    return m_CurrentTick;
+}
+
+embU32 TimerWheel::GetActiveTimerCount() const noexcept
+{
+    return m_ActiveCount;
+}
+
+embU32 TimerWheel::GetLastTickFiredCount() const noexcept
+{
+    return m_LastTickFiredCount;
+}
+
+embU32 TimerWheel::SecondsToTicks(embF32 seconds) const noexcept
+{
+    const embF32 ticks = std::round(seconds / EngineClock::Instance().GetFixedDT());
+    return ticks < 1.f ? 1u : ticks >= (embF32)embU32_MAX ? embU32_MAX : (embU32)ticks;
+}
+
+embU32 TimerWheel::AllocNode() noexcept
+{
+    if (m_FreeHead == NO_NODE)
+    {
+        m_Nodes.emplace_back();
+        return (embU32)m_Nodes.size() - 1;
+    }
+
+    const embU32 index = m_FreeHead;
+    m_FreeHead = m_Nodes[index].next;
+    return index;
+}
+
+void TimerWheel::FreeNode(embU32 index) noexcept
+{
+    TimerNode& node = m_Nodes[index];
+    node.generation++;
+    if (node.generation == 0) // keep ids non-zero
+        node.generation++;
+
+    node.state = TimerState::FREE;
+    node.list = NO_NODE;
+    node.prev = NO_NODE;
+    node.next = m_FreeHead;
+    m_FreeHead = index;
+}
+
+embU32 TimerWheel::FindNode(TimerId id) const noexcept
+{
+    const embU32 index = (embU32)id;
+    const embU32 generation = (embU32)(id >> 32);
+    if (index >= m_Nodes.size() || m_Nodes[index].generation != generation || m_Nodes[index].state == TimerState::FREE)
+        return NO_NODE;
+    return index;
+}
+
+void TimerWheel::Place(embU32 index) noexcept
+{
+    TimerNode& node = m_Nodes[index];
+
+    // The level is the highest group of bits where the expire tick differs from the current tick. The node then
+    // cascades down exactly when the current tick reaches that group's value.
+    const embU64 diff = node.expireTick ^ m_CurrentTick;
+    const embU32 level = diff == 0 ? 0 : (embU32)(std::bit_width(diff) - 1) / LEVEL_BITS;
+
+    embU32 list = OVERFLOW_LIST;
+    if (level < LEVEL_COUNT)
+        list = level * SLOTS_PER_LEVEL + (embU32)((node.expireTick >> (level * LEVEL_BITS)) & (SLOTS_PER_LEVEL - 1));
+
+    node.list = list;
+    node.prev = NO_NODE;
+    node.next = m_ListHeads[list];
+    if (node.next != NO_NODE)
+        m_Nodes[node.next].prev = index;
+    m_ListHeads[list] = index;
+}
+
+void TimerWheel::Unlink(embU32 index) noexcept
+{
+    TimerNode& node = m_Nodes[index];
+    if (node.prev != NO_NODE)
+        m_Nodes[node.prev].next = node.next;
+    else
+        m_ListHeads[node.list] = node.next;
+
+    if (node.next != NO_NODE)
+        m_Nodes[node.next].prev = node.prev;
+
+    node.prev = NO_NODE;
+    node.next = NO_NODE;
+    node.list = NO_NODE;
+}
+
+void TimerWheel::Cascade(embU32 list) noexcept
+{
+    embU32 index = m_ListHeads[list];
+    m_ListHeads[list] = NO_NODE;
+
+    while (index != NO_NODE)
+    {
+        const embU32 next = m_Nodes[index].next;
+        Place(index);
+        index = next;
+    }
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "engine/services.h"
+#include "util/containers.h"
+#include "util/macros.h"
+#include "util/types.h"
+
+EMB_NAMESPACE_START
+
+// Called when a timer expires. Can schedule or cancel timers (including itself).
+using TimerFunc = void (*)(void* userData);
+
+// Hierarchical timer wheel driven by sim ticks, for "fire in N ticks"/"every N seconds of sim time" callbacks.
+// Insert and cancel are O(1) and a tick only touches the timers that are due, instead of scanning every timer.
+// Since it counts fixed ticks, sim time scale and pausing apply for free.
+// 4 levels of 256 slots cover 2^32 ticks, anything further out waits in an overflow list.
+// Ticked from Engine::FixedUpdate. Use from the thread running fixed updates.
+class TimerWheel
+{
+  public:
+    using TimerId = embU64; // node index + generation, stale ids are ignored
+    static constexpr TimerId INVALID_TIMER = 0;
+
+    EMB_CLASS_SERVICE_MACRO(TimerWheel, TIMER_WHEEL)
+
+    TimerWheel() noexcept;
+
+    // Fires after delayTicks ticks (at least 1). Repeats every intervalTicks if non-zero.
+    TimerId ScheduleTicks(embU32 delayTicks, TimerFunc func, void* userData, embU32 intervalTicks = 0) noexcept;
+    // Fires after delaySeconds of sim time, rounded to the nearest tick. Repeats every intervalSeconds if non-zero.
+    // Seconds are converted with the fixed DT at the time of (re)scheduling.
+    TimerId ScheduleSeconds(embF32 delaySeconds, TimerFunc func, void* userData, embF32 intervalSeconds = 0.f) noexcept;
+    // Stops a timer. No-op if it already fired (and does not repeat) or was cancelled.
+    void Cancel(TimerId id) noexcept;
+    embBool IsScheduled(TimerId id) const noexcept;
+
+    // Advances one tick and runs every timer due on it. Call once per fixed tick.
+    void Tick() noexcept;
+
+    embU64 GetCurrentTick() const noexcept;
+    embU32 GetActiveTimerCount() const noexcept;
+    // Number of timers fired on the last tick.
+    embU32 GetLastTickFiredCount() const noexcept;
+
+  private:
+    static constexpr embU32 LEVEL_BITS = 8;
+    static constexpr embU32 SLOTS_PER_LEVEL = 1 << LEVEL_BITS;
+    static constexpr embU32 LEVEL_COUNT = 4;
+    static constexpr embU32 OVERFLOW_LIST = LEVEL_COUNT * SLOTS_PER_LEVEL; // list index of the overflow list
+    static constexpr embU32 NO_NODE = embU32_MAX;
+
+    enum class TimerState : embU8
+    {
+        FREE,
+        SCHEDULED, // sitting in a wheel slot
+        FIRING, // in the batch being fired this tick
+        CANCELLED, // cancelled while in the batch, freed once the batch is done
+        ENUM_COUNT
+    };
+
+    struct TimerNode
+    {
+        TimerFunc func = nullptr;
+        void* userData = nullptr;
+        embU64 expireTick = 0;
+        embU32 intervalTicks = 0;
+        embF32 intervalSeconds = 0.f; // non-zero for second based repeats, re-converted on each rearm
+        embU32 prev = NO_NODE;
+        embU32 next = NO_NODE; // also the free list link
+        embU32 list = NO_NODE; // slot list this node is in
+        embU32 generation = 1;
+        TimerState state = TimerState::FREE;
+    };
+
+    TimerId Schedule(embU64 expireTick, TimerFunc func, void* userData, embU32 intervalTicks, embF32 intervalSeconds) noexcept;
+    embU32 SecondsToTicks(embF32 seconds) const noexcept;
+
+    embU32 AllocNode() noexcept;
+    void FreeNode(embU32 index) noexcept;
+    // Returns the node index for a live id, NO_NODE if stale.
+    embU32 FindNode(TimerId id) const noexcept;
+
+    // Puts a node into the slot for its expire tick relative to the current tick.
+    void Place(embU32 index) noexcept;
+    void Unlink(embU32 index) noexcept;
+    // Re-places every node in a list, moving them down the levels.
+    void Cascade(embU32 list) noexcept;
+
+    embLargeArray<TimerNode> m_Nodes; // pooled, indices are stable
+    embU32 m_FreeHead = NO_NODE;
+    embFixedSizeArray<embU32, LEVEL_COUNT * SLOTS_PER_LEVEL + 1> m_ListHeads; // +1 for the overflow list
+
+    embLargeArray<embU32> m_Batch; // nodes expiring this tick, reused every tick
+    embU64 m_CurrentTick = 0; // next tick to be processed
+    embU32 m_ActiveCount = 0;
+    embU32 m_LastTickFiredCount = 0;
+};
+
+EMB_NAMESPACE_END
@@ -101,6 +101,11 @@ void WindowManager::PollInputEvents() noexcept
     glfwPollEvents();
 }
 
+void WindowManager::WaitInputEvents(embF64 timeoutSeconds) noexcept
+{
+    glfwWaitEventsTimeout(timeoutSeconds);
+}
+
 void WindowManager::SetWindowTitle(embStrView strView) noexcept
 {
     glfwSetWindowTitle(EMB_WINDOWPTR, strView.begin());
@@ -142,15 +147,24 @@ embBool WindowManager::GetWindowShouldClose() const noexcept
 
 void WindowManager::SetWindowIconified(embBool iconify)
 {
-    if (iconify == m_IsIconified)
+    // Note: ask GLFW instead of caching, the user can minimize/restore the window themselves.
+    if (iconify == IsWindowIconified())
         return;
 
-    m_IsIconified = iconify;
-
     if (iconify)
         glfwIconifyWindow(EMB_WINDOWPTR);
     else
         glfwRestoreWindow(EMB_WINDOWPTR);
 }
 
+embBool WindowManager::IsWindowIconified() const noexcept
+{
+    return glfwGetWindowAttrib(EMB_WINDOWPTR, GLFW_ICONIFIED) == GLFW_TRUE;
+}
+
+embBool WindowManager::IsWindowFocused() const noexcept
+{
+    return glfwGetWindowAttrib(EMB_WINDOWPTR, GLFW_FOCUSED) == GLFW_TRUE;
+}
+
 EMB_NAMESPACE_END
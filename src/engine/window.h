@@ -1,5 +1,6 @@
 #pragma once
 
+#include "engine/services.h"
 #include "util/str.h"
 #include "util/types.h"
 #include "util/vec2_coord_container.h"
@@ -9,12 +10,14 @@ EMB_NAMESPACE_START
 class WindowManager
 {
   public:
-    EMB_CLASS_SINGLETON_MACRO(WindowManager)
+    EMB_CLASS_SERVICE_MACRO(WindowManager, WINDOW_MANAGER)
 
     void Init();
     void Destroy();
 
     void PollInputEvents() noexcept;
+    // Blocks until an event arrives or timeoutSeconds pass, then processes events like PollInputEvents.
+    void WaitInputEvents(embF64 timeoutSeconds) noexcept;
 
     void SetWindowTitle(embStrView strView) noexcept;
 
@@ -30,9 +33,12 @@ class WindowManager
     void SetWindowIconified(embBool iconify);
     void MaximizeWindow();
 
+    // Current window state, including changes made by the user or the OS.
+    embBool IsWindowIconified() const noexcept;
+    embBool IsWindowFocused() const noexcept;
+
   private:
     embGenericPtr m_WindowHandle = nullptr;
-    embBool m_IsIconified = false;
 };
 
 EMB_NAMESPACE_END
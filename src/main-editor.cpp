@@ -1,6 +1,7 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 #include "imgui.h"
+#include "util/memtracker.h"
 #include <stdio.h>
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -70,6 +71,9 @@ int main(int, char**)
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    // count everything ImGui allocates under the Editor tag
+    ImGui::SetAllocatorFunctions([](size_t size, void*) { return ember::MemTracker::Allocate(ember::MemTag::EDITOR, size); },
+                                 [](void* ptr, void*) { ember::MemTracker::Free(ember::MemTag::EDITOR, ptr); });
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     (void)io;
@@ -195,6 +199,7 @@ int main(int, char**)
 
     glfwDestroyWindow(window);
     glfwTerminate();
+    ember::MemTracker::PrintReport("shutdown");
 
     return 0;
 }
@@ -1,9 +1,12 @@
 #include "pch-engine.h"
 
+#include <cstdlib>
+
 #include "util/bitset.h"
 #include "util/hash.h"
 #include "util/matrix.h"
 #include "util/matrix_utils.h"
+#include "util/memtracker.h"
 #include "util/str.h"
 #include "util/types.h"
 #include "util/vec.h"
@@ -12,13 +15,18 @@
 
 #include "engine/engine.h"
 #include "engine/engineclock.h"
+#include "engine/services.h"
 
 #include "util/str.h"
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace ember;
 
+    // --headless <sim seconds>: no window, virtual clock, runs the sim as fast as possible then exits.
+    const embBool headless = argc > 1 && embStrView(argv[1]) == "--headless";
+    const embF32 headlessSimSeconds = (headless && argc > 2) ? std::strtof(argv[2], nullptr) : 60.f;
+
     std::print("hello wurl\n");
 
     embVec2 hehe1 = embVec2();
@@ -57,25 +65,40 @@ int main()
     std::print("Hash of int {} and embS32 {} \n", Hash::GetTypeHash<int>(), Hash::GetTypeHash<const embS32>());
     //std::print("id of type float is {}", LookupTypeID(Hash::GetTypeHash<float>()));
 
+    ServiceRegistry services;
+    Engine::CreateServices(services);
+
     Engine& engine = Engine::Instance();
     EngineClock& timer = EngineClock::Instance();
 
+    engine.SetHeadless(headless);
+    timer.SetSimulationThreaded(false); // true to run FixedUpdate on its own thread
     engine.Init();
     engine.SetSimulationActive(true); // leave it on true to keep running
     timer.SetSimTimeScale(1.f);
     timer.SetTargetSimRate(20);
     timer.SetTargetFramerate(20);
+    timer.SetFramePacingMode(FramePacingMode::HYBRID); // sleep out the frame instead of busy-polling
+    timer.SetSimCatchUpPolicy(SimCatchUpPolicy::AUTO); // degrade sim rate instead of stuttering when overloaded
 
     while (engine.IsEngineRunning())
     {
-        if (timer.ShouldUpdate(engine.IsSimulationActive()))
+        if (timer.ShouldUpdate(engine.IsSimulationRunning()))
         {
+            for (embU32 i = 0; i < timer.ShouldFixedUpdate(); i++)
+                engine.FixedUpdate();
+
             engine.Update();
             engine.Render();
+
+            if (headless && timer.GetSimTimeElapsed() >= headlessSimSeconds)
+                engine.SignalEngineStop();
         }
     }
 
     engine.Destroy();
+    services.DestroyAll();
+    MemTracker::PrintReport("shutdown"); // anything still live is a leak
 
     return 0;
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <new>
+
+#include "macros.h"
+#include "memtracker.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// Allocators plug into engine containers as a template parameter. Any type with these two static functions works:
+//   static void* Allocate(embSizeT bytes, embSizeT alignment) noexcept;
+//   static void Free(void* ptr, embSizeT bytes, embSizeT alignment) noexcept;
+// Free always gets the same bytes/alignment that were allocated, so allocators don't need to store sizes.
+
+// Plain global heap, not tracked.
+struct RawHeapAllocator
+{
+    static void* Allocate(embSizeT bytes, embSizeT alignment) noexcept
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(bytes, std::align_val_t(alignment));
+        return ::operator new(bytes);
+    }
+
+    static void Free(void* ptr, embSizeT bytes, embSizeT alignment) noexcept
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(ptr, bytes, std::align_val_t(alignment));
+        else
+            ::operator delete(ptr, bytes);
+    }
+};
+
+// Global heap, counted under Tag by MemTracker.
+template<MemTag Tag>
+struct TaggedHeapAllocator
+{
+    static void* Allocate(embSizeT bytes, embSizeT alignment) noexcept
+    {
+        MemTracker::RecordAlloc(Tag, bytes);
+        return RawHeapAllocator::Allocate(bytes, alignment);
+    }
+
+    static void Free(void* ptr, embSizeT bytes, embSizeT alignment) noexcept
+    {
+        MemTracker::RecordFree(Tag, bytes);
+        RawHeapAllocator::Free(ptr, bytes, alignment);
+    }
+};
+
+// Default for engine containers.
+using HeapAllocator = TaggedHeapAllocator<MemTag::CONTAINERS>;
+
+// TaggedHeapAllocator for std containers and strings.
+template<typename T, MemTag Tag>
+struct TaggedStdAllocator
+{
+    using value_type = T;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = TaggedStdAllocator<U, Tag>;
+    };
+
+    TaggedStdAllocator() noexcept = default;
+    template<typename U>
+    TaggedStdAllocator(const TaggedStdAllocator<U, Tag>&) noexcept
+    {}
+
+    T* allocate(embSizeT count) noexcept
+    {
+        return (T*)TaggedHeapAllocator<Tag>::Allocate(count * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T* ptr, embSizeT count) noexcept
+    {
+        TaggedHeapAllocator<Tag>::Free(ptr, count * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const TaggedStdAllocator<U, Tag>&) const noexcept
+    {
+        return true;
+    }
+};
+
+EMB_NAMESPACE_END
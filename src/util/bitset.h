@@ -1,38 +1,640 @@
 #pragma once
 
-#include <climits> // for CHAR_BIT
-#include <cstring> // memset
+#include <bit>
 
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define EMB_BITSET_AVX2
+#endif
+
+#include "allocator.h"
+#include "compactarray.h"
 #include "macros.h"
+#include "macros_debug.h"
 #include "types.h"
 
-// TEMP
-#include <bitset>
-
 EMB_NAMESPACE_START
 
-// template<embU32 size>
-// struct Bitset
-// {
-//     using data_type = embU8;
-//     static constexpr embU32 bits_per_chunk = sizeof(data_type) * CHAR_BIT;
-//     static constexpr embU32 chunk_count = (size / bits_per_chunk) + (size % bits_per_chunk ? 1 : 0);
-//     static constexpr embU32 struct_size_bytes = (size / CHAR_BIT) + (size % CHAR_BIT ? 1 : 0);
+// Bitsets for slot allocation, component masks and dirty flags, where whole words get scanned every frame.
+// Bit i lives in word i / 64, at bit i % 64. Scans and iteration skip 64 clear bits at a time (tzcnt), count uses
+// popcnt, and bulk boolean ops go 256 bits at a time with AVX2 (build with EMB_DEF_SIMD=AVX2, see CMakeLists.txt).
+//   Bitset<N>            : fixed size, inline storage, constexpr friendly.
+//   DynamicBitset<Alloc> : size set at runtime, words come from Alloc.
+// Both have the std::bitset API plus the scan/iteration helpers in BitsetBase.
+
+//-------------------------------------------------------------------//
+//                            BitsetWords                            //
+//-------------------------------------------------------------------//
+
+// Word-level building blocks shared by both bitsets. Bits past the end of the last word are always kept clear, so
+// counts and scans never need to mask them out.
+struct BitsetWords
+{
+    using Word = embU64;
+    static constexpr embU32 WORD_BITS = 64;
+    static constexpr embU32 NOT_FOUND = embU32_MAX;
+
+    static constexpr embU32 GetWordCount(embU32 bitCount) noexcept
+    {
+        return (bitCount + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    // Bits of the last word that are inside the bitset.
+    static constexpr Word GetTailMask(embU32 bitCount) noexcept
+    {
+        const embU32 tailBits = bitCount % WORD_BITS;
+        return tailBits == 0 ? ~(Word)0 : ((Word)1 << tailBits) - 1;
+    }
+
+    static embU32 Count(const Word* words, embU32 wordCount) noexcept
+    {
+        embU32 count = 0;
+        for (embU32 i = 0; i < wordCount; i++)
+            count += (embU32)std::popcount(words[i]);
+        return count;
+    }
+
+    static embBool Any(const Word* words, embU32 wordCount) noexcept
+    {
+        embU32 i = 0;
+#ifdef EMB_BITSET_AVX2
+        for (; i + 4 <= wordCount; i += 4)
+        {
+            const __m256i block = _mm256_loadu_si256((const __m256i*)(words + i));
+            if (!_mm256_testz_si256(block, block))
+                return true;
+        }
+#endif
+        for (; i < wordCount; i++)
+        {
+            if (words[i] != 0)
+                return true;
+        }
+        return false;
+    }
+
+    // (a & b) != 0
+    static embBool Intersects(const Word* a, const Word* b, embU32 wordCount) noexcept
+    {
+        embU32 i = 0;
+#ifdef EMB_BITSET_AVX2
+        for (; i + 4 <= wordCount; i += 4)
+        {
+            if (!_mm256_testz_si256(Load(a + i), Load(b + i)))
+                return true;
+        }
+#endif
+        for (; i < wordCount; i++)
+        {
+            if ((a[i] & b[i]) != 0)
+                return true;
+        }
+        return false;
+    }
+
+    // (a & ~b) == 0, every bit set in a is set in b.
+    static embBool IsSubsetOf(const Word* a, const Word* b, embU32 wordCount) noexcept
+    {
+        embU32 i = 0;
+#ifdef EMB_BITSET_AVX2
+        for (; i + 4 <= wordCount; i += 4)
+        {
+            if (!_mm256_testc_si256(Load(b + i), Load(a + i)))
+                return false;
+        }
+#endif
+        for (; i < wordCount; i++)
+        {
+            if ((a[i] & ~b[i]) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // First set bit at or after from, NOT_FOUND if none.
+    static embU32 FindNextSet(const Word* words, embU32 wordCount, embU32 from) noexcept
+    {
+        embU32 wordIndex = from / WORD_BITS;
+        if (wordIndex >= wordCount)
+            return NOT_FOUND;
+
+        Word word = words[wordIndex] & (~(Word)0 << (from % WORD_BITS));
+        while (word == 0)
+        {
+            if (++wordIndex == wordCount)
+                return NOT_FOUND;
+            word = words[wordIndex];
+        }
+        return wordIndex * WORD_BITS + (embU32)std::countr_zero(word);
+    }
+
+    // First clear bit at or after from and below bitCount, NOT_FOUND if none.
+    static embU32 FindNextClear(const Word* words, embU32 bitCount, embU32 from) noexcept
+    {
+        const embU32 wordCount = GetWordCount(bitCount);
+        embU32 wordIndex = from / WORD_BITS;
+        if (wordIndex >= wordCount)
+            return NOT_FOUND;
+
+        Word word = ~words[wordIndex] & (~(Word)0 << (from % WORD_BITS));
+        while (word == 0)
+        {
+            if (++wordIndex == wordCount)
+                return NOT_FOUND;
+            word = ~words[wordIndex];
+        }
+
+        const embU32 index = wordIndex * WORD_BITS + (embU32)std::countr_zero(word);
+        return index < bitCount ? index : NOT_FOUND; // the clear tail bits don't count
+    }
+
+    // dst = a op b, word by word. dst may be a or b.
+    struct AndOp;
+    struct OrOp;
+    struct XorOp;
+    struct AndNotOp; // a & ~b
+
+    template<typename Op>
+    static void Combine(Word* dst, const Word* a, const Word* b, embU32 wordCount) noexcept
+    {
+        embU32 i = 0;
+#ifdef EMB_BITSET_AVX2
+        for (; i + 4 <= wordCount; i += 4)
+            _mm256_storeu_si256((__m256i*)(dst + i), Op::Apply(Load(a + i), Load(b + i)));
+#endif
+        for (; i < wordCount; i++)
+            dst[i] = Op::Apply(a[i], b[i]);
+    }
+
+  private:
+#ifdef EMB_BITSET_AVX2
+    static __m256i Load(const Word* words) noexcept
+    {
+        return _mm256_loadu_si256((const __m256i*)words);
+    }
+#endif
+};
+
+struct BitsetWords::AndOp
+{
+    static Word Apply(Word a, Word b) noexcept
+    {
+        return a & b;
+    }
+#ifdef EMB_BITSET_AVX2
+    static __m256i Apply(__m256i a, __m256i b) noexcept
+    {
+        return _mm256_and_si256(a, b);
+    }
+#endif
+};
+
+struct BitsetWords::OrOp
+{
+    static Word Apply(Word a, Word b) noexcept
+    {
+        return a | b;
+    }
+#ifdef EMB_BITSET_AVX2
+    static __m256i Apply(__m256i a, __m256i b) noexcept
+    {
+        return _mm256_or_si256(a, b);
+    }
+#endif
+};
+
+struct BitsetWords::XorOp
+{
+    static Word Apply(Word a, Word b) noexcept
+    {
+        return a ^ b;
+    }
+#ifdef EMB_BITSET_AVX2
+    static __m256i Apply(__m256i a, __m256i b) noexcept
+    {
+        return _mm256_xor_si256(a, b);
+    }
+#endif
+};
+
+struct BitsetWords::AndNotOp
+{
+    static Word Apply(Word a, Word b) noexcept
+    {
+        return a & ~b;
+    }
+#ifdef EMB_BITSET_AVX2
+    static __m256i Apply(__m256i a, __m256i b) noexcept
+    {
+        return _mm256_andnot_si256(b, a); // intrinsic negates its first operand
+    }
+#endif
+};
+
+//-------------------------------------------------------------------//
+//                            BitsetBase                             //
+//-------------------------------------------------------------------//
+
+// Iterates the indices of set bits, lowest first: for (embU32 index : bits.SetBits()).
+// Reads the words as it goes, don't modify the bitset while iterating.
+class SetBitRange
+{
+  public:
+    using Word = BitsetWords::Word;
+
+    class Iterator
+    {
+      public:
+        embU32 operator*() const noexcept
+        {
+            return m_WordIndex * BitsetWords::WORD_BITS + (embU32)std::countr_zero(m_Word);
+        }
+        Iterator& operator++() noexcept
+        {
+            m_Word &= m_Word - 1; // drop the lowest set bit
+            SkipClearWords();
+            return *this;
+        }
+        friend embBool operator==(const Iterator& lhs, const Iterator& rhs) noexcept
+        {
+            return lhs.m_WordIndex == rhs.m_WordIndex && lhs.m_Word == rhs.m_Word;
+        }
+
+      private:
+        friend class SetBitRange;
+
+        Iterator(const Word* words, embU32 wordCount, embU32 wordIndex) noexcept
+            : m_Words(words), m_WordCount(wordCount), m_WordIndex(wordIndex),
+              m_Word(wordIndex < wordCount ? words[wordIndex] : 0)
+        {
+            SkipClearWords();
+        }
+
+        void SkipClearWords() noexcept
+        {
+            while (m_Word == 0 && m_WordIndex < m_WordCount && ++m_WordIndex < m_WordCount)
+                m_Word = m_Words[m_WordIndex];
+        }
+
+        const Word* m_Words;
+        embU32 m_WordCount;
+        embU32 m_WordIndex;
+        Word m_Word; // bits of the current word not visited yet
+    };
+
+    SetBitRange(const Word* words, embU32 wordCount) noexcept : m_Words(words), m_WordCount(wordCount) {}
+
+    Iterator begin() const noexcept
+    {
+        return Iterator(m_Words, m_WordCount, 0);
+    }
+    Iterator end() const noexcept
+    {
+        return Iterator(m_Words, m_WordCount, m_WordCount);
+    }
+
+  private:
+    const Word* m_Words;
+    embU32 m_WordCount;
+};
+
+// The API both bitsets share, written against Derived's words. Derived provides GetWords() and size().
+template<typename Derived>
+class BitsetBase
+{
+  public:
+    using Word = BitsetWords::Word;
+    static constexpr embU32 NOT_FOUND = BitsetWords::NOT_FOUND;
+
+    //-------------------------------------------------------------------//
+    //                         std::bitset API                           //
+    //-------------------------------------------------------------------//
+
+    embBool test(embU32 index) const noexcept
+    {
+        EMB_ASSERT_HARD(index < Self().size(), "Bitset index out of range");
+        return (Self().GetWords()[index / BitsetWords::WORD_BITS] >> (index % BitsetWords::WORD_BITS)) & 1;
+    }
+    embBool operator[](embU32 index) const noexcept
+    {
+        return test(index);
+    }
 
-//     Bitset<size>()
-//     {
-//         std::memset(m_Data, 0, struct_size_bytes);
-//     }
+    Derived& set() noexcept
+    {
+        Word* words = Self().GetWords();
+        for (embU32 i = 0; i < GetWordCount(); i++)
+            words[i] = ~(Word)0;
+        return ClearTail();
+    }
+    Derived& set(embU32 index, embBool value = true) noexcept
+    {
+        EMB_ASSERT_HARD(index < Self().size(), "Bitset index out of range");
+        Word& word = Self().GetWords()[index / BitsetWords::WORD_BITS];
+        const Word bit = (Word)1 << (index % BitsetWords::WORD_BITS);
+        word = value ? word | bit : word & ~bit;
+        return Self();
+    }
 
-//   private:
-//     data_type m_Data[chunk_count];
-// };
+    Derived& reset() noexcept
+    {
+        Word* words = Self().GetWords();
+        for (embU32 i = 0; i < GetWordCount(); i++)
+            words[i] = 0;
+        return Self();
+    }
+    Derived& reset(embU32 index) noexcept
+    {
+        return set(index, false);
+    }
 
-// template<embU32 size>
-// using embBitset = Bitset<size>;
+    Derived& flip() noexcept
+    {
+        Word* words = Self().GetWords();
+        for (embU32 i = 0; i < GetWordCount(); i++)
+            words[i] = ~words[i];
+        return ClearTail();
+    }
+    Derived& flip(embU32 index) noexcept
+    {
+        EMB_ASSERT_HARD(index < Self().size(), "Bitset index out of range");
+        Self().GetWords()[index / BitsetWords::WORD_BITS] ^= (Word)1 << (index % BitsetWords::WORD_BITS);
+        return Self();
+    }
+
+    embU32 count() const noexcept
+    {
+        return BitsetWords::Count(Self().GetWords(), GetWordCount());
+    }
+    embBool any() const noexcept
+    {
+        return BitsetWords::Any(Self().GetWords(), GetWordCount());
+    }
+    embBool none() const noexcept
+    {
+        return !any();
+    }
+    embBool all() const noexcept
+    {
+        return FindFirstClear() == NOT_FOUND;
+    }
+
+    Derived& operator&=(const Derived& other) noexcept
+    {
+        return Combine<BitsetWords::AndOp>(other);
+    }
+    Derived& operator|=(const Derived& other) noexcept
+    {
+        return Combine<BitsetWords::OrOp>(other);
+    }
+    Derived& operator^=(const Derived& other) noexcept
+    {
+        return Combine<BitsetWords::XorOp>(other);
+    }
+
+    friend Derived operator&(Derived lhs, const Derived& rhs) noexcept
+    {
+        return lhs &= rhs;
+    }
+    friend Derived operator|(Derived lhs, const Derived& rhs) noexcept
+    {
+        return lhs |= rhs;
+    }
+    friend Derived operator^(Derived lhs, const Derived& rhs) noexcept
+    {
+        return lhs ^= rhs;
+    }
+    friend Derived operator~(Derived bits) noexcept
+    {
+        return bits.flip();
+    }
+
+    friend embBool operator==(const Derived& lhs, const Derived& rhs) noexcept
+    {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (embU32 i = 0; i < lhs.GetWordCount(); i++)
+        {
+            if (lhs.GetWords()[i] != rhs.GetWords()[i])
+                return false;
+        }
+        return true;
+    }
+
+    //-------------------------------------------------------------------//
+    //                        Scans and iteration                        //
+    //-------------------------------------------------------------------//
+
+    // Index of the lowest set bit, NOT_FOUND if none.
+    embU32 FindFirstSet() const noexcept
+    {
+        return FindNextSet(0);
+    }
+    // Lowest set bit at or after from, NOT_FOUND if none.
+    embU32 FindNextSet(embU32 from) const noexcept
+    {
+        return BitsetWords::FindNextSet(Self().GetWords(), GetWordCount(), from);
+    }
+    // Index of the lowest clear bit, NOT_FOUND if every bit is set. The free slot in an occupancy mask.
+    embU32 FindFirstClear() const noexcept
+    {
+        return FindNextClear(0);
+    }
+    embU32 FindNextClear(embU32 from) const noexcept
+    {
+        return BitsetWords::FindNextClear(Self().GetWords(), Self().size(), from);
+    }
+
+    // for (embU32 index : bits.SetBits())
+    SetBitRange SetBits() const noexcept
+    {
+        return SetBitRange(Self().GetWords(), GetWordCount());
+    }
+
+    // Calls func(index) for every set bit, lowest first. Faster than SetBits for a tight loop.
+    template<typename F>
+    void ForEachSetBit(F&& func) const noexcept
+    {
+        const Word* words = Self().GetWords();
+        for (embU32 i = 0; i < GetWordCount(); i++)
+        {
+            for (Word word = words[i]; word != 0; word &= word - 1)
+                func(i * BitsetWords::WORD_BITS + (embU32)std::countr_zero(word));
+        }
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Bulk ops                              //
+    //-------------------------------------------------------------------//
+
+    // this &= ~other. e.g. dirty.AndNot(handled)
+    Derived& AndNot(const Derived& other) noexcept
+    {
+        return Combine<BitsetWords::AndNotOp>(other);
+    }
+
+    // dst = a & b etc. without a temporary. dst may be a or b.
+    static void And(Derived& dst, const Derived& a, const Derived& b) noexcept
+    {
+        CombineInto<BitsetWords::AndOp>(dst, a, b);
+    }
+    static void Or(Derived& dst, const Derived& a, const Derived& b) noexcept
+    {
+        CombineInto<BitsetWords::OrOp>(dst, a, b);
+    }
+    static void Xor(Derived& dst, const Derived& a, const Derived& b) noexcept
+    {
+        CombineInto<BitsetWords::XorOp>(dst, a, b);
+    }
+    // dst = a & ~b
+    static void AndNot(Derived& dst, const Derived& a, const Derived& b) noexcept
+    {
+        CombineInto<BitsetWords::AndNotOp>(dst, a, b);
+    }
+
+    // Any bit set in both. e.g. a system's component mask against an entity's.
+    embBool Intersects(const Derived& other) const noexcept
+    {
+        AssertSameSize(Self(), other);
+        return BitsetWords::Intersects(Self().GetWords(), other.GetWords(), GetWordCount());
+    }
+    // Every bit set in other is set here too.
+    embBool Contains(const Derived& other) const noexcept
+    {
+        AssertSameSize(Self(), other);
+        return BitsetWords::IsSubsetOf(other.GetWords(), Self().GetWords(), GetWordCount());
+    }
+
+    embU32 GetWordCount() const noexcept
+    {
+        return BitsetWords::GetWordCount(Self().size());
+    }
+
+  private:
+    Derived& Self() noexcept
+    {
+        return static_cast<Derived&>(*this);
+    }
+    const Derived& Self() const noexcept
+    {
+        return static_cast<const Derived&>(*this);
+    }
+
+    Derived& ClearTail() noexcept
+    {
+        if (GetWordCount() > 0)
+            Self().GetWords()[GetWordCount() - 1] &= BitsetWords::GetTailMask(Self().size());
+        return Self();
+    }
+
+    static void AssertSameSize(const Derived& a, const Derived& b) noexcept
+    {
+        EMB_ASSERT_HARD(a.size() == b.size(), "Bitset sizes don't match");
+    }
+
+    template<typename Op>
+    Derived& Combine(const Derived& other) noexcept
+    {
+        CombineInto<Op>(Self(), Self(), other);
+        return Self();
+    }
+
+    template<typename Op>
+    static void CombineInto(Derived& dst, const Derived& a, const Derived& b) noexcept
+    {
+        AssertSameSize(dst, a);
+        AssertSameSize(a, b);
+        BitsetWords::Combine<Op>(dst.GetWords(), a.GetWords(), b.GetWords(), dst.GetWordCount());
+    }
+};
+
+//-------------------------------------------------------------------//
+//                               Bitset                              //
+//-------------------------------------------------------------------//
+
+template<embU32 N>
+class Bitset : public BitsetBase<Bitset<N>>
+{
+    EMB_ASSERT_STATIC(N > 0, "Bitset needs at least one bit");
+
+  public:
+    using Word = BitsetWords::Word;
+    static constexpr embU32 WORD_COUNT = BitsetWords::GetWordCount(N);
+
+    constexpr Bitset() noexcept = default;
+
+    static constexpr embU32 size() noexcept
+    {
+        return N;
+    }
+
+    Word* GetWords() noexcept
+    {
+        return m_Words;
+    }
+    const Word* GetWords() const noexcept
+    {
+        return m_Words;
+    }
+
+  private:
+    Word m_Words[WORD_COUNT] {};
+};
+
+//-------------------------------------------------------------------//
+//                           DynamicBitset                           //
+//-------------------------------------------------------------------//
+
+template<typename Allocator = HeapAllocator>
+class DynamicBitset : public BitsetBase<DynamicBitset<Allocator>>
+{
+  public:
+    using Word = BitsetWords::Word;
+
+    DynamicBitset() noexcept = default;
+    explicit DynamicBitset(embU32 bitCount, embBool value = false)
+    {
+        resize(bitCount, value);
+    }
+
+    embU32 size() const noexcept
+    {
+        return m_BitCount;
+    }
+
+    // New bits are set to value, existing bits keep theirs.
+    void resize(embU32 bitCount, embBool value = false)
+    {
+        const embU32 oldBitCount = m_BitCount;
+        m_Words.resize(BitsetWords::GetWordCount(bitCount), value ? ~(Word)0 : 0);
+        m_BitCount = bitCount;
+
+        // the old tail bits were clear, set them if needed. Then clear the new tail.
+        if (value && oldBitCount % BitsetWords::WORD_BITS != 0 && bitCount > oldBitCount)
+            m_Words[oldBitCount / BitsetWords::WORD_BITS] |= ~BitsetWords::GetTailMask(oldBitCount);
+        if (!m_Words.empty())
+            m_Words.back() &= BitsetWords::GetTailMask(bitCount);
+    }
+
+    Word* GetWords() noexcept
+    {
+        return m_Words.data();
+    }
+    const Word* GetWords() const noexcept
+    {
+        return m_Words.data();
+    }
+
+  private:
+    CompactArray<Word, embU32, Allocator> m_Words;
+    embU32 m_BitCount = 0;
+};
 
 template<embU32 size>
-using embBitset = std::bitset<size>;
+using embBitset = Bitset<size>;
+
+template<typename Allocator = HeapAllocator>
+using embDynamicBitset = DynamicBitset<Allocator>;
 
 // 8-bit bitmask for bit operations
 using embBitset8 = embBitset<8>;
@@ -0,0 +1,446 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.h"
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// Dynamic array with a SizeType size/capacity instead of std::vector's three pointers: 16 bytes instead of 24 for both
+// u16 and u32, which adds up in tables holding thousands of arrays. Growing past what SizeType can count aborts, in
+// release builds too.
+// Same API as std::vector, minus exceptions. Memory comes from Allocator (see allocator.h).
+// Iterators are plain pointers, and like std::vector they're invalidated by anything that grows the array.
+template<typename T, typename SizeType, typename Allocator = HeapAllocator>
+class CompactArray
+{
+    EMB_ASSERT_STATIC(std::is_unsigned_v<SizeType>, "CompactArray size type must be unsigned");
+
+  public:
+    using value_type = T;
+    using size_type = SizeType;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using allocator_type = Allocator;
+
+    static constexpr embSizeT MAX_SIZE = std::numeric_limits<SizeType>::max();
+
+    //-------------------------------------------------------------------//
+    //                       Construct / Destruct                        //
+    //-------------------------------------------------------------------//
+
+    CompactArray() noexcept = default;
+
+    explicit CompactArray(embSizeT count)
+    {
+        resize(count);
+    }
+
+    CompactArray(embSizeT count, const T& value)
+    {
+        resize(count, value);
+    }
+
+    CompactArray(std::initializer_list<T> list) : CompactArray(list.begin(), list.end()) {}
+
+    template<typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    CompactArray(InputIt first, InputIt last)
+    {
+        assign(first, last);
+    }
+
+    CompactArray(const CompactArray& other)
+    {
+        reserve(other.m_Size);
+        std::uninitialized_copy(other.begin(), other.end(), m_Data);
+        m_Size = other.m_Size;
+    }
+
+    CompactArray(CompactArray&& other) noexcept
+        : m_Data(std::exchange(other.m_Data, nullptr)),
+          m_Size(std::exchange(other.m_Size, 0)),
+          m_Capacity(std::exchange(other.m_Capacity, 0))
+    {}
+
+    ~CompactArray() noexcept
+    {
+        clear();
+        FreeData(m_Data, m_Capacity);
+    }
+
+    CompactArray& operator=(const CompactArray& other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    CompactArray& operator=(CompactArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            FreeData(m_Data, m_Capacity);
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+            m_Capacity = std::exchange(other.m_Capacity, 0);
+        }
+        return *this;
+    }
+
+    CompactArray& operator=(std::initializer_list<T> list)
+    {
+        assign(list.begin(), list.end());
+        return *this;
+    }
+
+    template<typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+            reserve((embSizeT)std::distance(first, last));
+
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    void assign(embSizeT count, const T& value)
+    {
+        clear();
+        resize(count, value);
+    }
+
+    //-------------------------------------------------------------------//
+    //                              Access                               //
+    //-------------------------------------------------------------------//
+
+    T& operator[](embSizeT index) noexcept
+    {
+        EMB_ASSERT_HARD(index < m_Size, "CompactArray index out of range");
+        return m_Data[index];
+    }
+    const T& operator[](embSizeT index) const noexcept
+    {
+        EMB_ASSERT_HARD(index < m_Size, "CompactArray index out of range");
+        return m_Data[index];
+    }
+    // No exceptions, so same as operator[].
+    T& at(embSizeT index) noexcept
+    {
+        return (*this)[index];
+    }
+    const T& at(embSizeT index) const noexcept
+    {
+        return (*this)[index];
+    }
+
+    T& front() noexcept
+    {
+        return (*this)[0];
+    }
+    const T& front() const noexcept
+    {
+        return (*this)[0];
+    }
+    T& back() noexcept
+    {
+        return (*this)[m_Size - 1];
+    }
+    const T& back() const noexcept
+    {
+        return (*this)[m_Size - 1];
+    }
+
+    T* data() noexcept
+    {
+        return m_Data;
+    }
+    const T* data() const noexcept
+    {
+        return m_Data;
+    }
+
+    iterator begin() noexcept
+    {
+        return m_Data;
+    }
+    const_iterator begin() const noexcept
+    {
+        return m_Data;
+    }
+    const_iterator cbegin() const noexcept
+    {
+        return m_Data;
+    }
+    iterator end() noexcept
+    {
+        return m_Data + m_Size;
+    }
+    const_iterator end() const noexcept
+    {
+        return m_Data + m_Size;
+    }
+    const_iterator cend() const noexcept
+    {
+        return m_Data + m_Size;
+    }
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Capacity                              //
+    //-------------------------------------------------------------------//
+
+    embBool empty() const noexcept
+    {
+        return m_Size == 0;
+    }
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+    size_type capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+    static constexpr embSizeT max_size() noexcept
+    {
+        return MAX_SIZE;
+    }
+
+    void reserve(embSizeT newCapacity)
+    {
+        if (newCapacity > m_Capacity)
+            Reallocate(newCapacity);
+    }
+
+    void shrink_to_fit()
+    {
+        if (m_Size != m_Capacity)
+            Reallocate(m_Size);
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Modifiers                             //
+    //-------------------------------------------------------------------//
+
+    void clear() noexcept
+    {
+        std::destroy(begin(), end());
+        m_Size = 0;
+    }
+
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_Size == m_Capacity)
+            return GrowAndEmplaceBack(std::forward<Args>(args)...);
+
+        T* element = std::construct_at(m_Data + m_Size, std::forward<Args>(args)...);
+        m_Size++;
+        return *element;
+    }
+
+    void pop_back() noexcept
+    {
+        EMB_ASSERT_HARD(m_Size > 0, "pop_back on an empty CompactArray");
+        m_Size--;
+        std::destroy_at(m_Data + m_Size);
+    }
+
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args)
+    {
+        const embSizeT index = (embSizeT)(position - cbegin());
+        EMB_ASSERT_HARD(index <= m_Size, "CompactArray insert position out of range");
+
+        if (index == m_Size)
+        {
+            emplace_back(std::forward<Args>(args)...);
+            return begin() + index;
+        }
+
+        // args may point into this array, build the value before anything moves.
+        T value(std::forward<Args>(args)...);
+        emplace_back(std::move(back()));
+        std::move_backward(begin() + index, end() - 2, end() - 1);
+        m_Data[index] = std::move(value);
+        return begin() + index;
+    }
+
+    iterator insert(const_iterator position, const T& value)
+    {
+        return emplace(position, value);
+    }
+    iterator insert(const_iterator position, T&& value)
+    {
+        return emplace(position, std::move(value));
+    }
+
+    iterator erase(const_iterator position) noexcept
+    {
+        return erase(position, position + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) noexcept
+    {
+        T* eraseBegin = begin() + (first - cbegin());
+        T* eraseEnd = begin() + (last - cbegin());
+        EMB_ASSERT_HARD(eraseBegin <= eraseEnd && eraseEnd <= end(), "CompactArray erase range out of range");
+
+        T* newEnd = std::move(eraseEnd, end(), eraseBegin);
+        std::destroy(newEnd, end());
+        m_Size = (size_type)(newEnd - begin());
+        return eraseBegin;
+    }
+
+    void resize(embSizeT count)
+    {
+        ResizeImpl(count, [](T* ptr) { std::construct_at(ptr); });
+    }
+
+    void resize(embSizeT count, const T& value)
+    {
+        ResizeImpl(count, [&value](T* ptr) { std::construct_at(ptr, value); });
+    }
+
+    void swap(CompactArray& other) noexcept
+    {
+        std::swap(m_Data, other.m_Data);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_Capacity, other.m_Capacity);
+    }
+
+    friend void swap(CompactArray& lhs, CompactArray& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+
+    friend embBool operator==(const CompactArray& lhs, const CompactArray& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+  private:
+    static T* AllocateData(embSizeT count) noexcept
+    {
+        return (T*)Allocator::Allocate(count * sizeof(T), alignof(T));
+    }
+
+    static void FreeData(T* data, embSizeT count) noexcept
+    {
+        if (data != nullptr)
+            Allocator::Free(data, count * sizeof(T), alignof(T));
+    }
+
+    // Always on: past MAX_SIZE, size and capacity would wrap and writes would land past the buffer.
+    static void CheckCapacity(embSizeT capacity) noexcept
+    {
+        if (EMB_BRANCH_UNLIKELY(capacity > MAX_SIZE))
+            CapacityOverflow(capacity);
+    }
+
+    EMB_NO_INLINE static void CapacityOverflow(embSizeT capacity) noexcept
+    {
+        printf("Fatal: CompactArray grew to %zu elements, past its size type (max %zu), use a larger array type\n",
+               capacity, MAX_SIZE);
+        fflush(stdout);
+        std::abort();
+    }
+
+    // Every growth path (reserve, resize, insert, copy) ends up here or in GrowAndEmplaceBack.
+    void Reallocate(embSizeT newCapacity)
+    {
+        CheckCapacity(newCapacity);
+
+        T* newData = newCapacity > 0 ? AllocateData(newCapacity) : nullptr;
+        std::uninitialized_move(begin(), end(), newData);
+        std::destroy(begin(), end());
+        FreeData(m_Data, m_Capacity);
+
+        m_Data = newData;
+        m_Capacity = (size_type)newCapacity;
+    }
+
+    template<typename... Args>
+    T& GrowAndEmplaceBack(Args&&... args)
+    {
+        CheckCapacity((embSizeT)m_Capacity + 1); // before constructing, a full array has nowhere to put the element
+        const embSizeT newCapacity = std::min<embSizeT>(std::max<embSizeT>(m_Capacity * 2, 4), MAX_SIZE);
+        T* newData = AllocateData(newCapacity);
+
+        // construct first, args may point into the old buffer.
+        T* element = std::construct_at(newData + m_Size, std::forward<Args>(args)...);
+        std::uninitialized_move(begin(), end(), newData);
+        std::destroy(begin(), end());
+        FreeData(m_Data, m_Capacity);
+
+        m_Data = newData;
+        m_Capacity = (size_type)newCapacity;
+        m_Size++;
+        return *element;
+    }
+
+    template<typename ConstructFunc>
+    void ResizeImpl(embSizeT count, ConstructFunc construct)
+    {
+        if (count < m_Size)
+        {
+            std::destroy(begin() + count, end());
+            m_Size = (size_type)count;
+            return;
+        }
+
+        reserve(count);
+        for (; m_Size < count; m_Size++)
+            construct(m_Data + m_Size);
+    }
+
+    T* m_Data = nullptr;
+    size_type m_Size = 0;
+    size_type m_Capacity = 0;
+};
+
+EMB_NAMESPACE_END
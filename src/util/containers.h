@@ -1,37 +1,45 @@
 #pragma once
 
+#include "allocator.h"
+#include "compactarray.h"
+#include "flatmap.h"
+#include "inplacearray.h"
+#include "pingpongbuffer.h"
+#include "ringbuffer.h"
 #include "types.h"
 #include <array>
-#include <unordered_map>
 #include <vector>
 
 // to split this up... too many containers!
 
 EMB_NAMESPACE_START
 
-template<typename T>
-using embArray = std::vector<T>; // use u16 by default, 65k elements.
+template<typename T, typename Allocator = HeapAllocator>
+using embArray = CompactArray<T, embU16, Allocator>; // use u16 by default, 65k elements.
 
-template<typename T>
-using embLargeArray = std::vector<T>; // use u32 or sth instead of u16
+template<typename T, typename Allocator = HeapAllocator>
+using embLargeArray = CompactArray<T, embU32, Allocator>; // use u32 or sth instead of u16
 
-template<typename T>
-using embInplaceArray = std::vector<T>; // slap on stack default, excess goes to heap.
+template<typename T, embU32 N>
+using embInplaceArray = InplaceArray<T, N>; // slap on stack default, excess goes to heap.
 
 template<typename T, embU64 size>
 using embFixedSizeArray = std::array<T, size>; // fixed size array
 
-template<typename T>
-using embPingPongBuffer = std::vector<T>;
+template<typename T, embU32 N = 3>
+using embPingPongBuffer = PingPongBuffer<T, N>; // writer fills one copy while the reader reads the latest
 
-template<typename T>
-using embQueueBuffer = std::vector<T>;
+template<typename T, embU32 N>
+using embQueueBuffer = SpscRingBuffer<T, N>; // one producer thread, one consumer thread
 
-template<typename T>
-using embCircularBuffer = std::vector<T>;
+template<typename T, embU32 N>
+using embMpmcQueueBuffer = MpmcRingBuffer<T, N>; // any threads
+
+template<typename T, embU32 N>
+using embCircularBuffer = RingBuffer<T, N>; // single thread, can overwrite the oldest
 
-template <typename Key, typename Value>
-using embMap = std::unordered_map<Key, Value>;
+template<typename Key, typename Value, typename Hasher = MapHash<Key>, typename Allocator = HeapAllocator>
+using embMap = FlatMap<Key, Value, Hasher, Allocator>; // open addressing, elements move on insert
 
 template<typename T>
 using embList = std::vector<T>;
@@ -42,7 +50,4 @@ using embSet = std::vector<T>;
 template<typename T>
 using embStreeeeng = std::vector<T>;
 
-template<typename T>
-using embBitset = std::vector<T>;
-
 EMB_NAMESPACE_END
@@ -0,0 +1,622 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define EMB_FLATMAP_SSE2
+#endif
+
+#include "allocator.h"
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// MurmurHash3 finalizer. std::hash of an integer is the integer itself, which would put every small key in the same
+// control group. This spreads the bits over the whole 64 bits first.
+constexpr embU64 MixHash(embU64 value) noexcept
+{
+    value ^= value >> 33;
+    value *= 0xff'51'af'd7'ed'55'8c'cd;
+    value ^= value >> 33;
+    value *= 0xc4'ce'b9'fe'1a'85'ec'53;
+    value ^= value >> 33;
+    return value;
+}
+
+// Default FlatMap hasher: std::hash, mixed.
+template<typename Key>
+struct MapHash
+{
+    embU64 operator()(const Key& key) const noexcept
+    {
+        return MixHash((embU64)std::hash<Key> {}(key));
+    }
+};
+
+// Open addressing hash map, Swiss table style. Keys and values live inline in one flat array, next to a byte of
+// metadata ("control byte") per slot: empty, deleted, or 7 bits of the key's hash. Lookups compare a group of 16
+// control bytes at once (SSE2 where available) and only touch the slots whose hash bits match, so a lookup is
+// usually one cache miss for the control group and one for the slot.
+// Same API as std::unordered_map for what the engine uses, minus buckets and exceptions. Unlike std::unordered_map,
+// any insert can move elements, which invalidates iterators, pointers and references. Erase only invalidates the
+// erased element.
+template<typename Key, typename Value, typename Hasher = MapHash<Key>, typename Allocator = HeapAllocator>
+class FlatMap
+{
+  public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<const Key, Value>;
+    using size_type = embU32;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hasher;
+    using allocator_type = Allocator;
+
+    template<embBool IS_CONST>
+    class Iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IS_CONST, const value_type*, value_type*>;
+        using reference = std::conditional_t<IS_CONST, const value_type&, value_type&>;
+
+        Iterator() noexcept = default;
+        // iterator to const_iterator. A template so it never counts as the copy constructor.
+        template<embBool IS_OTHER_CONST>
+            requires(IS_CONST && !IS_OTHER_CONST)
+        Iterator(const Iterator<IS_OTHER_CONST>& other) noexcept
+            : m_Ctrl(other.m_Ctrl), m_Slot(other.m_Slot), m_CtrlEnd(other.m_CtrlEnd)
+        {}
+
+        reference operator*() const noexcept
+        {
+            return *m_Slot;
+        }
+        pointer operator->() const noexcept
+        {
+            return m_Slot;
+        }
+
+        Iterator& operator++() noexcept
+        {
+            m_Ctrl++;
+            m_Slot++;
+            SkipFree();
+            return *this;
+        }
+        Iterator operator++(int) noexcept
+        {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend embBool operator==(const Iterator& lhs, const Iterator& rhs) noexcept
+        {
+            return lhs.m_Ctrl == rhs.m_Ctrl;
+        }
+
+      private:
+        friend class FlatMap;
+        friend class Iterator<!IS_CONST>;
+
+        Iterator(const embS8* ctrl, pointer slot, const embS8* ctrlEnd) noexcept
+            : m_Ctrl(ctrl), m_Slot(slot), m_CtrlEnd(ctrlEnd)
+        {}
+
+        void SkipFree() noexcept
+        {
+            while (m_Ctrl != m_CtrlEnd && *m_Ctrl < 0)
+            {
+                m_Ctrl++;
+                m_Slot++;
+            }
+        }
+
+        const embS8* m_Ctrl = nullptr;
+        pointer m_Slot = nullptr;
+        const embS8* m_CtrlEnd = nullptr;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    //-------------------------------------------------------------------//
+    //                       Construct / Destruct                        //
+    //-------------------------------------------------------------------//
+
+    FlatMap() noexcept = default;
+
+    explicit FlatMap(const Hasher& hash) noexcept : m_Hasher(hash) {}
+
+    FlatMap(std::initializer_list<value_type> list)
+    {
+        reserve((embU32)list.size());
+        for (const value_type& value : list)
+            insert(value);
+    }
+
+    FlatMap(const FlatMap& other) : m_Hasher(other.m_Hasher)
+    {
+        reserve(other.m_Size);
+        for (const value_type& value : other)
+            insert(value);
+    }
+
+    FlatMap(FlatMap&& other) noexcept
+        : m_Ctrl(std::exchange(other.m_Ctrl, nullptr)),
+          m_Slots(std::exchange(other.m_Slots, nullptr)),
+          m_Size(std::exchange(other.m_Size, 0)),
+          m_Capacity(std::exchange(other.m_Capacity, 0)),
+          m_GrowthLeft(std::exchange(other.m_GrowthLeft, 0)),
+          m_Hasher(other.m_Hasher)
+    {}
+
+    ~FlatMap() noexcept
+    {
+        clear();
+        FreeTable(m_Ctrl, m_Capacity);
+    }
+
+    FlatMap& operator=(const FlatMap& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            m_Hasher = other.m_Hasher;
+            reserve(other.m_Size);
+            for (const value_type& value : other)
+                insert(value);
+        }
+        return *this;
+    }
+
+    FlatMap& operator=(FlatMap&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            FreeTable(m_Ctrl, m_Capacity);
+            m_Ctrl = std::exchange(other.m_Ctrl, nullptr);
+            m_Slots = std::exchange(other.m_Slots, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+            m_Capacity = std::exchange(other.m_Capacity, 0);
+            m_GrowthLeft = std::exchange(other.m_GrowthLeft, 0);
+            m_Hasher = other.m_Hasher;
+        }
+        return *this;
+    }
+
+    //-------------------------------------------------------------------//
+    //                              Lookup                               //
+    //-------------------------------------------------------------------//
+
+    iterator find(const Key& key) noexcept
+    {
+        return MakeIterator(FindIndex(key, m_Hasher(key)));
+    }
+    const_iterator find(const Key& key) const noexcept
+    {
+        return MakeIterator(FindIndex(key, m_Hasher(key)));
+    }
+
+    embBool contains(const Key& key) const noexcept
+    {
+        return FindIndex(key, m_Hasher(key)) != m_Capacity;
+    }
+    size_type count(const Key& key) const noexcept
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    // No exceptions, asserts if key is missing.
+    Value& at(const Key& key) noexcept
+    {
+        const embU32 index = FindIndex(key, m_Hasher(key));
+        EMB_ASSERT_HARD(index != m_Capacity, "FlatMap::at key not found");
+        return m_Slots[index].second;
+    }
+    const Value& at(const Key& key) const noexcept
+    {
+        const embU32 index = FindIndex(key, m_Hasher(key));
+        EMB_ASSERT_HARD(index != m_Capacity, "FlatMap::at key not found");
+        return m_Slots[index].second;
+    }
+
+    Value& operator[](const Key& key)
+    {
+        return TryEmplaceImpl(key).first->second;
+    }
+    Value& operator[](Key&& key)
+    {
+        return TryEmplaceImpl(std::move(key)).first->second;
+    }
+
+    iterator begin() noexcept
+    {
+        iterator it(m_Ctrl, m_Slots, m_Ctrl + m_Capacity);
+        it.SkipFree();
+        return it;
+    }
+    const_iterator begin() const noexcept
+    {
+        const_iterator it(m_Ctrl, m_Slots, m_Ctrl + m_Capacity);
+        it.SkipFree();
+        return it;
+    }
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+    iterator end() noexcept
+    {
+        return MakeIterator(m_Capacity);
+    }
+    const_iterator end() const noexcept
+    {
+        return MakeIterator(m_Capacity);
+    }
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Capacity                              //
+    //-------------------------------------------------------------------//
+
+    embBool empty() const noexcept
+    {
+        return m_Size == 0;
+    }
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+    // Slot count, the map grows before it gets 7/8 full.
+    size_type capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    // Makes room for count elements without growing again.
+    void reserve(embU32 count)
+    {
+        if (count <= m_Size + m_GrowthLeft)
+            return;
+
+        embU32 newCapacity = std::max(m_Capacity, GROUP_WIDTH);
+        while (GetMaxLoad(newCapacity) < count)
+            newCapacity *= 2;
+        Resize(newCapacity);
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Modifiers                             //
+    //-------------------------------------------------------------------//
+
+    // Keeps the capacity.
+    void clear() noexcept
+    {
+        if (m_Capacity == 0)
+            return;
+
+        if constexpr (!std::is_trivially_destructible_v<value_type>)
+        {
+            for (embU32 i = 0; i < m_Capacity; i++)
+            {
+                if (m_Ctrl[i] >= 0)
+                    std::destroy_at(m_Slots + i);
+            }
+        }
+        std::memset(m_Ctrl, CTRL_EMPTY, m_Capacity);
+        m_Size = 0;
+        m_GrowthLeft = GetMaxLoad(m_Capacity);
+    }
+
+    // Does nothing (and returns false) if key is already in the map.
+    template<typename K, typename... Args>
+    std::pair<iterator, embBool> try_emplace(K&& key, Args&&... args)
+    {
+        return TryEmplaceImpl(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, embBool> emplace(Args&&... args)
+    {
+        std::pair<Key, Value> value(std::forward<Args>(args)...);
+        return TryEmplaceImpl(std::move(value.first), std::move(value.second));
+    }
+
+    std::pair<iterator, embBool> insert(const value_type& value)
+    {
+        return TryEmplaceImpl(value.first, value.second);
+    }
+    std::pair<iterator, embBool> insert(value_type&& value)
+    {
+        return TryEmplaceImpl(value.first, std::move(value.second));
+    }
+
+    template<typename V>
+    std::pair<iterator, embBool> insert_or_assign(const Key& key, V&& value)
+    {
+        std::pair<iterator, embBool> result = TryEmplaceImpl(key, std::forward<V>(value));
+        if (!result.second)
+            result.first->second = std::forward<V>(value);
+        return result;
+    }
+
+    size_type erase(const Key& key) noexcept
+    {
+        const embU32 index = FindIndex(key, m_Hasher(key));
+        if (index == m_Capacity)
+            return 0;
+
+        EraseAt(index);
+        return 1;
+    }
+
+    // Returns the element after position.
+    iterator erase(const_iterator position) noexcept
+    {
+        const embU32 index = (embU32)(position.m_Ctrl - m_Ctrl);
+        EMB_ASSERT_HARD(index < m_Capacity && m_Ctrl[index] >= 0, "FlatMap erase of an invalid iterator");
+
+        EraseAt(index);
+        iterator next = MakeIterator(index);
+        next.SkipFree();
+        return next;
+    }
+
+    void swap(FlatMap& other) noexcept
+    {
+        std::swap(m_Ctrl, other.m_Ctrl);
+        std::swap(m_Slots, other.m_Slots);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_Capacity, other.m_Capacity);
+        std::swap(m_GrowthLeft, other.m_GrowthLeft);
+        std::swap(m_Hasher, other.m_Hasher);
+    }
+
+  private:
+    static constexpr embU32 GROUP_WIDTH = 16;
+    // Full slots store the low 7 hash bits (0..127), free ones are negative so a sign check tells them apart.
+    static constexpr embS8 CTRL_EMPTY = -128;
+    static constexpr embS8 CTRL_DELETED = -2;
+
+    // 16 control bytes, returns one bit per matching byte.
+    struct Group
+    {
+#ifdef EMB_FLATMAP_SSE2
+        explicit Group(const embS8* ctrl) noexcept : bytes(_mm_load_si128((const __m128i*)ctrl)) {}
+
+        embU32 Match(embS8 h2) const noexcept
+        {
+            return (embU32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), bytes));
+        }
+        embU32 MatchEmpty() const noexcept
+        {
+            return Match(CTRL_EMPTY);
+        }
+        embU32 MatchFree() const noexcept
+        {
+            return (embU32)_mm_movemask_epi8(bytes); // sign bits, empty or deleted
+        }
+
+        __m128i bytes;
+#else
+        explicit Group(const embS8* ctrl) noexcept
+        {
+            std::memcpy(bytes, ctrl, GROUP_WIDTH);
+        }
+
+        embU32 Match(embS8 h2) const noexcept
+        {
+            embU32 mask = 0;
+            for (embU32 i = 0; i < GROUP_WIDTH; i++)
+                mask |= (embU32)(bytes[i] == h2) << i;
+            return mask;
+        }
+        embU32 MatchEmpty() const noexcept
+        {
+            return Match(CTRL_EMPTY);
+        }
+        embU32 MatchFree() const noexcept
+        {
+            embU32 mask = 0;
+            for (embU32 i = 0; i < GROUP_WIDTH; i++)
+                mask |= (embU32)(bytes[i] < 0) << i;
+            return mask;
+        }
+
+        embS8 bytes[GROUP_WIDTH];
+#endif
+    };
+
+    static embU64 GetH1(embU64 hash) noexcept
+    {
+        return hash >> 7;
+    }
+    static embS8 GetH2(embU64 hash) noexcept
+    {
+        return (embS8)(hash & 0x7f);
+    }
+    static embU32 GetMaxLoad(embU32 capacity) noexcept
+    {
+        return capacity - capacity / 8;
+    }
+
+    static constexpr embSizeT TABLE_ALIGNMENT = std::max<embSizeT>(GROUP_WIDTH, alignof(value_type));
+    static embSizeT GetSlotsOffset(embU32 capacity) noexcept
+    {
+        return ((embSizeT)capacity + alignof(value_type) - 1) & ~(embSizeT)(alignof(value_type) - 1);
+    }
+    static embSizeT GetTableSize(embU32 capacity) noexcept
+    {
+        return GetSlotsOffset(capacity) + (embSizeT)capacity * sizeof(value_type);
+    }
+
+    iterator MakeIterator(embU32 index) noexcept
+    {
+        return iterator(m_Ctrl + index, m_Slots + index, m_Ctrl + m_Capacity);
+    }
+    const_iterator MakeIterator(embU32 index) const noexcept
+    {
+        return const_iterator(m_Ctrl + index, m_Slots + index, m_Ctrl + m_Capacity);
+    }
+
+    // Probes whole groups, triangular steps visit every group once when the group count is a power of two.
+    // Returns m_Capacity if key isn't in the map.
+    embU32 FindIndex(const Key& key, embU64 hash) const noexcept
+    {
+        if (m_Capacity == 0)
+            return 0;
+
+        const embS8 h2 = GetH2(hash);
+        const embU32 groupMask = m_Capacity / GROUP_WIDTH - 1;
+        embU32 groupIndex = (embU32)GetH1(hash) & groupMask;
+        for (embU32 step = 1;; step++)
+        {
+            const embU32 base = groupIndex * GROUP_WIDTH;
+            const Group group(m_Ctrl + base);
+            for (embU32 mask = group.Match(h2); mask != 0; mask &= mask - 1)
+            {
+                const embU32 index = base + (embU32)std::countr_zero(mask);
+                if (EMB_BRANCH_LIKELY(m_Slots[index].first == key))
+                    return index;
+            }
+
+            // an empty slot means inserts never had to probe past this group.
+            if (group.MatchEmpty() != 0)
+                return m_Capacity;
+            groupIndex = (groupIndex + step) & groupMask;
+        }
+    }
+
+    // First empty or deleted slot on hash's probe sequence. The table always has an empty slot left.
+    embU32 FindFreeIndex(embU64 hash) const noexcept
+    {
+        const embU32 groupMask = m_Capacity / GROUP_WIDTH - 1;
+        embU32 groupIndex = (embU32)GetH1(hash) & groupMask;
+        for (embU32 step = 1;; step++)
+        {
+            const embU32 mask = Group(m_Ctrl + groupIndex * GROUP_WIDTH).MatchFree();
+            if (mask != 0)
+                return groupIndex * GROUP_WIDTH + (embU32)std::countr_zero(mask);
+            groupIndex = (groupIndex + step) & groupMask;
+        }
+    }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, embBool> TryEmplaceImpl(K&& key, Args&&... args)
+    {
+        const embU64 hash = m_Hasher(key);
+        embU32 index = FindIndex(key, hash);
+        if (index != m_Capacity)
+            return {MakeIterator(index), false};
+
+        index = PrepareInsert(hash);
+        std::construct_at(m_Slots + index, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+        return {MakeIterator(index), true};
+    }
+
+    // Claims a slot for a new key with hash, growing first if needed. The caller constructs the element.
+    embU32 PrepareInsert(embU64 hash)
+    {
+        if (m_Capacity == 0)
+            Resize(GROUP_WIDTH);
+
+        embU32 index = FindFreeIndex(hash);
+        if (m_GrowthLeft == 0 && m_Ctrl[index] == CTRL_EMPTY)
+        {
+            // mostly tombstones: rehash in place to clear them. Otherwise really full, double.
+            Resize(m_Size < GetMaxLoad(m_Capacity) / 2 ? m_Capacity : m_Capacity * 2);
+            index = FindFreeIndex(hash);
+        }
+
+        if (m_Ctrl[index] == CTRL_EMPTY)
+            m_GrowthLeft--;
+        m_Ctrl[index] = GetH2(hash);
+        m_Size++;
+        return index;
+    }
+
+    void EraseAt(embU32 index) noexcept
+    {
+        std::destroy_at(m_Slots + index);
+        m_Size--;
+
+        // lookups stop at a group with an empty slot, so if this one has one nobody probes past it and the slot can
+        // go straight back to empty. Otherwise leave a tombstone to keep probe chains through here intact.
+        if (Group(m_Ctrl + (index & ~(GROUP_WIDTH - 1))).MatchEmpty() != 0)
+        {
+            m_Ctrl[index] = CTRL_EMPTY;
+            m_GrowthLeft++;
+        }
+        else
+            m_Ctrl[index] = CTRL_DELETED;
+    }
+
+    void Resize(embU32 newCapacity)
+    {
+        EMB_ASSERT_HARD(newCapacity >= GROUP_WIDTH && std::has_single_bit(newCapacity),
+                        "FlatMap capacity must be a power of two of at least one group");
+
+        embS8* oldCtrl = m_Ctrl;
+        value_type* oldSlots = m_Slots;
+        const embU32 oldCapacity = m_Capacity;
+
+        m_Ctrl = (embS8*)Allocator::Allocate(GetTableSize(newCapacity), TABLE_ALIGNMENT);
+        m_Slots = (value_type*)((embU8*)m_Ctrl + GetSlotsOffset(newCapacity));
+        m_Capacity = newCapacity;
+        m_GrowthLeft = GetMaxLoad(newCapacity) - m_Size;
+        std::memset(m_Ctrl, CTRL_EMPTY, newCapacity);
+
+        for (embU32 i = 0; i < oldCapacity; i++)
+        {
+            if (oldCtrl[i] < 0)
+                continue;
+
+            value_type* oldSlot = oldSlots + i;
+            const embU64 hash = m_Hasher(oldSlot->first);
+            const embU32 index = FindFreeIndex(hash);
+            m_Ctrl[index] = GetH2(hash);
+
+            // the old element is destroyed right after, moving out of its const key is fine.
+            std::construct_at(m_Slots + index, std::move(const_cast<Key&>(oldSlot->first)), std::move(oldSlot->second));
+            std::destroy_at(oldSlot);
+        }
+
+        FreeTable(oldCtrl, oldCapacity);
+    }
+
+    static void FreeTable(embS8* ctrl, embU32 capacity) noexcept
+    {
+        if (ctrl != nullptr)
+            Allocator::Free(ctrl, GetTableSize(capacity), TABLE_ALIGNMENT);
+    }
+
+    embS8* m_Ctrl = nullptr; // capacity control bytes, followed by the slots in the same allocation
+    value_type* m_Slots = nullptr;
+    embU32 m_Size = 0;
+    embU32 m_Capacity = 0;
+    embU32 m_GrowthLeft = 0; // inserts into empty slots left before a rehash
+    [[no_unique_address]] Hasher m_Hasher {};
+};
+
+EMB_NAMESPACE_END
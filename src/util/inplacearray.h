@@ -0,0 +1,459 @@
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// Vector with room for N elements inside the object itself. Only allocates once it grows past N, so short temporary lists
+// built on the stack never touch the heap. Same API as std::vector, minus the allocator and exceptions.
+// Moving an inline array moves the elements one by one, moving a spilled one just steals the heap buffer.
+// Iterators are plain pointers, and like std::vector they're invalidated by anything that grows the array.
+template<typename T, embU32 N>
+class InplaceArray
+{
+    EMB_ASSERT_STATIC(N > 0, "InplaceArray needs room for at least one element, use embArray otherwise");
+
+  public:
+    using value_type = T;
+    using size_type = embU32;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_type INPLACE_CAPACITY = N;
+
+    //-------------------------------------------------------------------//
+    //                       Construct / Destruct                        //
+    //-------------------------------------------------------------------//
+
+    InplaceArray() noexcept : m_Data(GetInlineData()) {}
+
+    explicit InplaceArray(size_type count) : InplaceArray()
+    {
+        resize(count);
+    }
+
+    InplaceArray(size_type count, const T& value) : InplaceArray()
+    {
+        resize(count, value);
+    }
+
+    InplaceArray(std::initializer_list<T> list) : InplaceArray(list.begin(), list.end()) {}
+
+    template<typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    InplaceArray(InputIt first, InputIt last) : InplaceArray()
+    {
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+            reserve((size_type)std::distance(first, last));
+
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    InplaceArray(const InplaceArray& other) : InplaceArray()
+    {
+        reserve(other.m_Size);
+        std::uninitialized_copy(other.begin(), other.end(), m_Data);
+        m_Size = other.m_Size;
+    }
+
+    InplaceArray(InplaceArray&& other) noexcept : InplaceArray()
+    {
+        MoveFrom(other);
+    }
+
+    ~InplaceArray() noexcept
+    {
+        clear();
+        FreeHeap();
+    }
+
+    InplaceArray& operator=(const InplaceArray& other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    InplaceArray& operator=(InplaceArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            FreeHeap();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceArray& operator=(std::initializer_list<T> list)
+    {
+        assign(list.begin(), list.end());
+        return *this;
+    }
+
+    template<typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+            reserve((size_type)std::distance(first, last));
+
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    void assign(size_type count, const T& value)
+    {
+        clear();
+        resize(count, value);
+    }
+
+    //-------------------------------------------------------------------//
+    //                              Access                               //
+    //-------------------------------------------------------------------//
+
+    T& operator[](size_type index) noexcept
+    {
+        EMB_ASSERT_HARD(index < m_Size, "InplaceArray index out of range");
+        return m_Data[index];
+    }
+    const T& operator[](size_type index) const noexcept
+    {
+        EMB_ASSERT_HARD(index < m_Size, "InplaceArray index out of range");
+        return m_Data[index];
+    }
+    // No exceptions, so same as operator[].
+    T& at(size_type index) noexcept
+    {
+        return (*this)[index];
+    }
+    const T& at(size_type index) const noexcept
+    {
+        return (*this)[index];
+    }
+
+    T& front() noexcept
+    {
+        return (*this)[0];
+    }
+    const T& front() const noexcept
+    {
+        return (*this)[0];
+    }
+    T& back() noexcept
+    {
+        return (*this)[m_Size - 1];
+    }
+    const T& back() const noexcept
+    {
+        return (*this)[m_Size - 1];
+    }
+
+    T* data() noexcept
+    {
+        return m_Data;
+    }
+    const T* data() const noexcept
+    {
+        return m_Data;
+    }
+
+    iterator begin() noexcept
+    {
+        return m_Data;
+    }
+    const_iterator begin() const noexcept
+    {
+        return m_Data;
+    }
+    const_iterator cbegin() const noexcept
+    {
+        return m_Data;
+    }
+    iterator end() noexcept
+    {
+        return m_Data + m_Size;
+    }
+    const_iterator end() const noexcept
+    {
+        return m_Data + m_Size;
+    }
+    const_iterator cend() const noexcept
+    {
+        return m_Data + m_Size;
+    }
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Capacity                              //
+    //-------------------------------------------------------------------//
+
+    embBool empty() const noexcept
+    {
+        return m_Size == 0;
+    }
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+    size_type capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+    // True while the elements still live in the inline storage.
+    embBool IsInplace() const noexcept
+    {
+        return m_Data == GetInlineData();
+    }
+
+    void reserve(size_type newCapacity)
+    {
+        if (newCapacity > m_Capacity)
+            Reallocate(newCapacity);
+    }
+
+    // Moves the elements back inline if they fit, otherwise into a heap buffer of exactly size().
+    void shrink_to_fit()
+    {
+        if (IsInplace() || m_Size == m_Capacity)
+            return;
+        Reallocate(m_Size);
+    }
+
+    //-------------------------------------------------------------------//
+    //                             Modifiers                             //
+    //-------------------------------------------------------------------//
+
+    void clear() noexcept
+    {
+        std::destroy(begin(), end());
+        m_Size = 0;
+    }
+
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_Size == m_Capacity)
+            return GrowAndEmplaceBack(std::forward<Args>(args)...);
+
+        T* element = std::construct_at(m_Data + m_Size, std::forward<Args>(args)...);
+        m_Size++;
+        return *element;
+    }
+
+    void pop_back() noexcept
+    {
+        EMB_ASSERT_HARD(m_Size > 0, "pop_back on an empty InplaceArray");
+        m_Size--;
+        std::destroy_at(m_Data + m_Size);
+    }
+
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args)
+    {
+        const size_type index = (size_type)(position - begin());
+        EMB_ASSERT_HARD(index <= m_Size, "InplaceArray insert position out of range");
+
+        if (index == m_Size)
+        {
+            emplace_back(std::forward<Args>(args)...);
+            return begin() + index;
+        }
+
+        // args may point into this array, build the value before anything moves.
+        T value(std::forward<Args>(args)...);
+        emplace_back(std::move(back()));
+        std::move_backward(begin() + index, end() - 2, end() - 1);
+        m_Data[index] = std::move(value);
+        return begin() + index;
+    }
+
+    iterator insert(const_iterator position, const T& value)
+    {
+        return emplace(position, value);
+    }
+    iterator insert(const_iterator position, T&& value)
+    {
+        return emplace(position, std::move(value));
+    }
+
+    iterator erase(const_iterator position) noexcept
+    {
+        return erase(position, position + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) noexcept
+    {
+        T* eraseBegin = begin() + (first - cbegin());
+        T* eraseEnd = begin() + (last - cbegin());
+        EMB_ASSERT_HARD(eraseBegin <= eraseEnd && eraseEnd <= end(), "InplaceArray erase range out of range");
+
+        T* newEnd = std::move(eraseEnd, end(), eraseBegin);
+        std::destroy(newEnd, end());
+        m_Size = (size_type)(newEnd - begin());
+        return eraseBegin;
+    }
+
+    void resize(size_type count)
+    {
+        ResizeImpl(count, [](T* ptr) { std::construct_at(ptr); });
+    }
+
+    void resize(size_type count, const T& value)
+    {
+        ResizeImpl(count, [&value](T* ptr) { std::construct_at(ptr, value); });
+    }
+
+    void swap(InplaceArray& other) noexcept
+    {
+        InplaceArray temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+    friend embBool operator==(const InplaceArray& lhs, const InplaceArray& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+  private:
+    T* GetInlineData() noexcept
+    {
+        return std::launder((T*)m_Inline);
+    }
+    const T* GetInlineData() const noexcept
+    {
+        return std::launder((const T*)m_Inline);
+    }
+
+    static T* AllocateHeap(size_type count)
+    {
+        return std::allocator<T>().allocate(count);
+    }
+
+    void FreeHeap() noexcept
+    {
+        if (!IsInplace())
+            std::allocator<T>().deallocate(m_Data, m_Capacity);
+        m_Data = GetInlineData();
+        m_Capacity = N;
+    }
+
+    // Moves the elements into a buffer of newCapacity (inline if it fits).
+    void Reallocate(size_type newCapacity)
+    {
+        T* newData = newCapacity <= N ? GetInlineData() : AllocateHeap(newCapacity);
+        if (newData == m_Data)
+            return;
+
+        std::uninitialized_move(begin(), end(), newData);
+        std::destroy(begin(), end());
+        const size_type size = m_Size;
+        FreeHeap();
+
+        m_Data = newData;
+        m_Capacity = newCapacity <= N ? N : newCapacity;
+        m_Size = size;
+    }
+
+    template<typename... Args>
+    T& GrowAndEmplaceBack(Args&&... args)
+    {
+        const size_type newCapacity = m_Capacity * 2;
+        T* newData = AllocateHeap(newCapacity);
+
+        // construct first, args may point into the old buffer.
+        T* element = std::construct_at(newData + m_Size, std::forward<Args>(args)...);
+        std::uninitialized_move(begin(), end(), newData);
+        std::destroy(begin(), end());
+
+        const size_type size = m_Size;
+        FreeHeap();
+        m_Data = newData;
+        m_Capacity = newCapacity;
+        m_Size = size + 1;
+        return *element;
+    }
+
+    template<typename ConstructFunc>
+    void ResizeImpl(size_type count, ConstructFunc construct)
+    {
+        if (count < m_Size)
+        {
+            std::destroy(begin() + count, end());
+            m_Size = count;
+            return;
+        }
+
+        reserve(count);
+        for (; m_Size < count; m_Size++)
+            construct(m_Data + m_Size);
+    }
+
+    // Takes other's elements, leaving it empty. This must be empty and inline.
+    void MoveFrom(InplaceArray& other) noexcept
+    {
+        if (other.IsInplace())
+        {
+            std::uninitialized_move(other.begin(), other.end(), m_Data);
+            m_Size = other.m_Size;
+            other.clear();
+            return;
+        }
+
+        m_Data = other.m_Data;
+        m_Size = other.m_Size;
+        m_Capacity = other.m_Capacity;
+        other.m_Data = other.GetInlineData();
+        other.m_Size = 0;
+        other.m_Capacity = N;
+    }
+
+    T* m_Data;
+    size_type m_Size = 0;
+    size_type m_Capacity = N;
+    alignas(T) unsigned char m_Inline[sizeof(T) * N];
+};
+
+EMB_NAMESPACE_END
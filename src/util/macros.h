@@ -19,7 +19,8 @@
 
 // ===== Singleton creator ====
 // TODO: Make this thread safe-r.
-// Shorthand for singleton getter member functions
+// Shorthand for singleton getter member functions. Engine services use EMB_CLASS_SERVICE_MACRO (engine/services.h)
+// instead, so their lifetimes are explicit.
 #define EMB_CLASS_SINGLETON_MACRO(className) \
     static className& Instance() \
     { \
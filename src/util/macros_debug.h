@@ -2,8 +2,6 @@
 #include "macros.h"
 #include <cassert>
 
-EMB_NAMESPACE_START
-
 // ===== Toggles =====
 // debug levels
 #if defined(_DEBUG) || !defined(NDEBUG) || defined(DEBUG)
@@ -43,6 +41,12 @@ EMB_NAMESPACE_START
 #    error "Compiler not supported!"
 #endif
 
+#if defined(EMB_DEF_MSVC)
+#    include <intrin.h> // _mm_pause, for EMB_CPU_PAUSE
+#endif
+
+EMB_NAMESPACE_START
+
 // ===== Compiler Hints ====
 #if defined(EMB_DEF_CLANG) || defined(EMB_DEF_GCC)
 #    define EMB_BRANCH_UNLIKELY(expr) __builtin_expect(bool(expr), 0)
@@ -62,6 +66,14 @@ EMB_NAMESPACE_START
 #    define EMB_FASTCALL __attribute__((fastcall))
 
 #    define EMB_THREAD_LOCAL thread_local // May not work for gcc?
+
+#    if defined(__x86_64__) || defined(__i386__)
+#        define EMB_CPU_PAUSE() __builtin_ia32_pause() // hint to the cpu that we are in a spin-wait loop
+#    elif defined(__aarch64__) || defined(__arm__)
+#        define EMB_CPU_PAUSE() __asm__ __volatile__("yield")
+#    else
+#        define EMB_CPU_PAUSE()
+#    endif
 #elif defined(EMB_DEF_MSVC)
 #    undef CDECL
 // Unfortunately visual studio does not have a branch prediction primitive.
@@ -82,10 +94,15 @@ EMB_NAMESPACE_START
 #    define EMB_FASTCALL __fastcall
 
 #    define EMB_THREAD_LOCAL __declspec(thread)
+
+#    define EMB_CPU_PAUSE() _mm_pause() // hint to the cpu that we are in a spin-wait loop
 #else
 #    error "unsupported platform for compiler hints"
 #endif
 
+// Size to pad/align data written by different threads to, so they don't false share. Right for x86 and most ARM.
+#define EMB_CACHE_LINE_SIZE 64
+
 #if defined(EMB_DEF_CLANG)
 #    define EMB_OPTIMIZE_FILE_OFF _Pragma("clang optimize off")
 #    define EMB_OPTIMIZE_FILE_ON _Pragma("clang optimize on")
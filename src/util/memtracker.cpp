@@ -0,0 +1,245 @@
+#include "memtracker.h"
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+EMB_NAMESPACE_START
+
+constexpr embSizeT MEMTAG_COUNT = (embSizeT)MemTag::ENUM_COUNT;
+// Allocate/Reallocate keep the block size in front of the block, sized to keep the block max aligned.
+constexpr embSizeT ALLOC_HEADER_SIZE = alignof(std::max_align_t);
+EMB_ASSERT_STATIC(ALLOC_HEADER_SIZE >= sizeof(embSizeT), "MemTracker allocation header can't hold the size");
+
+constexpr const char* MEMTAG_NAMES[] = {"General", "Resources", "Graphics", "Strings", "Containers", "Editor"};
+EMB_ASSERT_STATIC(std::size(MEMTAG_NAMES) == MEMTAG_COUNT, "missing MemTag name");
+
+// One thread's counters, on cache lines of their own.
+struct alignas(EMB_CACHE_LINE_SIZE) ThreadMemCounters
+{
+    std::atomic<embS64> liveBytes[MEMTAG_COUNT];
+    std::atomic<embS64> liveCount[MEMTAG_COUNT];
+    std::atomic<embU64> totalCount[MEMTAG_COUNT];
+    std::atomic<embS64> peakBytes[MEMTAG_COUNT];
+    std::atomic<embBool> isClaimed; // a live thread counts here
+};
+
+// Static storage, allocations made during static init are counted too.
+static constinit ThreadMemCounters s_ThreadCounters[MemTracker::MAX_THREADS];
+static constinit ThreadMemCounters s_SharedCounters; // threads past MAX_THREADS
+static constinit std::atomic<embU32> s_ClaimedThreads = 0; // highest counter slot handed out + 1
+static constinit std::atomic<embS64> s_PeakBytes[MEMTAG_COUNT];
+
+static constinit EMB_THREAD_LOCAL ThreadMemCounters* t_MemCounters = nullptr;
+
+// Gives the thread's counters back when it exits. What it counted stays in them (what a thread allocated outlives it),
+// the next thread to claim them keeps adding on top.
+// Plain thread_local: __declspec(thread) doesn't run destructors.
+struct ThreadCountersOwner
+{
+    ~ThreadCountersOwner() noexcept
+    {
+        ThreadMemCounters* counters = t_MemCounters;
+        // frees later in this thread's exit go to the shared counters.
+        t_MemCounters = &s_SharedCounters;
+        if (counters != nullptr && counters != &s_SharedCounters)
+            counters->isClaimed.store(false, std::memory_order_release);
+    }
+};
+
+static thread_local ThreadCountersOwner t_ThreadCountersOwner;
+
+static ThreadMemCounters* ClaimThreadCounters() noexcept
+{
+    for (embU32 i = 0; i < MemTracker::MAX_THREADS; i++)
+    {
+        embBool expected = false;
+        if (s_ThreadCounters[i].isClaimed.load(std::memory_order_relaxed)
+            || !s_ThreadCounters[i].isClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            continue;
+
+        embU32 claimed = s_ClaimedThreads.load(std::memory_order_relaxed);
+        while (claimed < i + 1 && !s_ClaimedThreads.compare_exchange_weak(claimed, i + 1, std::memory_order_relaxed))
+        {
+        }
+        return &s_ThreadCounters[i];
+    }
+    return &s_SharedCounters;
+}
+
+static ThreadMemCounters& GetThreadCounters() noexcept
+{
+    if (EMB_BRANCH_LIKELY(t_MemCounters != nullptr))
+        return *t_MemCounters;
+
+    // first allocation on this thread. Touching the owner registers its destructor for this thread.
+    (void)&t_ThreadCountersOwner;
+    t_MemCounters = ClaimThreadCounters();
+    return *t_MemCounters;
+}
+
+static void AddToCounters(MemTag tag, embS64 bytes, embS64 count) noexcept
+{
+    EMB_ASSERT_HARD(tag < MemTag::ENUM_COUNT, "MemTag out of range");
+    const embSizeT index = (embSizeT)tag;
+    ThreadMemCounters& counters = GetThreadCounters();
+
+    embS64 liveBytes = 0;
+    if (EMB_BRANCH_LIKELY(&counters != &s_SharedCounters))
+    {
+        // only this thread writes here, no read-modify-write needed.
+        liveBytes = counters.liveBytes[index].load(std::memory_order_relaxed) + bytes;
+        counters.liveBytes[index].store(liveBytes, std::memory_order_relaxed);
+        counters.liveCount[index].store(counters.liveCount[index].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        if (count > 0)
+            counters.totalCount[index].store(counters.totalCount[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        liveBytes = counters.liveBytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        counters.liveCount[index].fetch_add(count, std::memory_order_relaxed);
+        if (count > 0)
+            counters.totalCount[index].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // racy between sharing threads, good enough for a high-water mark.
+    if (liveBytes > counters.peakBytes[index].load(std::memory_order_relaxed))
+        counters.peakBytes[index].store(liveBytes, std::memory_order_relaxed);
+}
+
+const char* GetMemTagName(MemTag tag) noexcept
+{
+    EMB_ASSERT_HARD(tag < MemTag::ENUM_COUNT, "MemTag out of range");
+    return MEMTAG_NAMES[(embSizeT)tag];
+}
+
+//-------------------------------------------------------------------//
+//                             Recording                             //
+//-------------------------------------------------------------------//
+
+void MemTracker::RecordAlloc(MemTag tag, embSizeT bytes) noexcept
+{
+    AddToCounters(tag, (embS64)bytes, 1);
+}
+
+void MemTracker::RecordFree(MemTag tag, embSizeT bytes) noexcept
+{
+    AddToCounters(tag, -(embS64)bytes, -1);
+}
+
+void* MemTracker::Allocate(MemTag tag, embSizeT bytes) noexcept
+{
+    unsigned char* block = (unsigned char*)std::malloc(ALLOC_HEADER_SIZE + bytes);
+    if (block == nullptr)
+        return nullptr;
+
+    *(embSizeT*)block = bytes;
+    RecordAlloc(tag, bytes);
+    return block + ALLOC_HEADER_SIZE;
+}
+
+void* MemTracker::Reallocate(MemTag tag, void* ptr, embSizeT bytes) noexcept
+{
+    if (ptr == nullptr)
+        return Allocate(tag, bytes);
+
+    unsigned char* block = (unsigned char*)ptr - ALLOC_HEADER_SIZE;
+    const embSizeT oldBytes = *(embSizeT*)block;
+    unsigned char* newBlock = (unsigned char*)std::realloc(block, ALLOC_HEADER_SIZE + bytes);
+    if (newBlock == nullptr)
+        return nullptr; // old block is untouched, still counted
+
+    *(embSizeT*)newBlock = bytes;
+    RecordFree(tag, oldBytes);
+    RecordAlloc(tag, bytes);
+    return newBlock + ALLOC_HEADER_SIZE;
+}
+
+void MemTracker::Free(MemTag tag, void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+
+    unsigned char* block = (unsigned char*)ptr - ALLOC_HEADER_SIZE;
+    RecordFree(tag, *(embSizeT*)block);
+    std::free(block);
+}
+
+//-------------------------------------------------------------------//
+//                              Queries                              //
+//-------------------------------------------------------------------//
+
+// Raises the global peak of a tag to liveBytes if higher. Any thread.
+static void RaisePeak(embSizeT index, embS64 liveBytes) noexcept
+{
+    embS64 peak = s_PeakBytes[index].load(std::memory_order_relaxed);
+    while (liveBytes > peak && !s_PeakBytes[index].compare_exchange_weak(peak, liveBytes, std::memory_order_relaxed))
+    {
+    }
+}
+
+MemTagStats MemTracker::GetStats(MemTag tag) noexcept
+{
+    EMB_ASSERT_HARD(tag < MemTag::ENUM_COUNT, "MemTag out of range");
+    const embSizeT index = (embSizeT)tag;
+
+    MemTagStats stats;
+    const auto addCounters = [&](const ThreadMemCounters& counters) {
+        stats.liveBytes += counters.liveBytes[index].load(std::memory_order_relaxed);
+        stats.liveCount += counters.liveCount[index].load(std::memory_order_relaxed);
+        stats.totalCount += counters.totalCount[index].load(std::memory_order_relaxed);
+    };
+
+    const embU32 threadCount = GetThreadCount();
+    for (embU32 i = 0; i < threadCount; i++)
+        addCounters(s_ThreadCounters[i]);
+    addCounters(s_SharedCounters);
+
+    RaisePeak(index, stats.liveBytes);
+    stats.peakBytes = s_PeakBytes[index].load(std::memory_order_relaxed);
+    return stats;
+}
+
+embS64 MemTracker::GetTotalLiveBytes() noexcept
+{
+    embS64 total = 0;
+    for (embSizeT i = 0; i < MEMTAG_COUNT; i++)
+        total += GetStats((MemTag)i).liveBytes;
+    return total;
+}
+
+embS64 MemTracker::GetThreadPeakBytes(MemTag tag) noexcept
+{
+    EMB_ASSERT_HARD(tag < MemTag::ENUM_COUNT, "MemTag out of range");
+    return GetThreadCounters().peakBytes[(embSizeT)tag].load(std::memory_order_relaxed);
+}
+
+embU32 MemTracker::GetThreadCount() noexcept
+{
+    const embU32 claimed = s_ClaimedThreads.load(std::memory_order_relaxed);
+    return claimed < MAX_THREADS ? claimed : MAX_THREADS;
+}
+
+void MemTracker::UpdatePeaks() noexcept
+{
+    // GetStats folds the totals into the peaks as it goes.
+    for (embSizeT i = 0; i < MEMTAG_COUNT; i++)
+        GetStats((MemTag)i);
+}
+
+void MemTracker::PrintReport(const char* when) noexcept
+{
+    printf("Memory still allocated at %s:\n", when);
+    for (embSizeT i = 0; i < MEMTAG_COUNT; i++)
+    {
+        const MemTagStats stats = GetStats((MemTag)i);
+        printf("  %-10s %12lld bytes in %8lld allocations (peak %lld bytes, %llu allocations made)\n",
+               MEMTAG_NAMES[i], (long long)stats.liveBytes, (long long)stats.liveCount, (long long)stats.peakBytes,
+               (unsigned long long)stats.totalCount);
+    }
+}
+
+EMB_NAMESPACE_END
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// What an allocation is for. Every tracked allocation is counted under exactly one tag.
+enum class MemTag : embU8
+{
+    GENERAL, // anything without a better tag (e.g. FrameArena chunks)
+    RESOURCES, // ResourceManager pools
+    GRAPHICS, // decoded images and other CPU-side graphics data
+    STRINGS, // embStr
+    CONTAINERS, // engine containers on the default HeapAllocator
+    EDITOR, // ImGui
+    ENUM_COUNT
+};
+
+const char* GetMemTagName(MemTag tag) noexcept;
+
+struct MemTagStats
+{
+    embS64 liveBytes = 0; // allocated and not freed yet
+    embS64 liveCount = 0;
+    embU64 totalCount = 0; // allocations ever made
+    embS64 peakBytes = 0; // highest liveBytes seen by UpdatePeaks
+};
+
+// Allocation counters per MemTag, cheap enough to leave on in release. Each thread counts into its own cache line with
+// plain relaxed stores, no locks and no shared atomics on the allocation path. Queries sum up all threads.
+// A thread's counters can go negative when it frees what another thread allocated, only the sums mean anything.
+//
+// The global peak is sampled, not exact: UpdatePeaks runs at every frame boundary (EngineClock) and on every query, so a
+// spike that comes and goes within a frame is missed. Each thread also keeps the exact high-water mark of its own count.
+//
+// Allocators report here themselves (TaggedHeapAllocator, PoolAllocator), code that allocates on its own calls
+// RecordAlloc/RecordFree. C-style APIs that free without a size (stb, ImGui) use Allocate/Reallocate/Free.
+class MemTracker
+{
+  public:
+    // Threads that can hold counters of their own at once. A thread gives its counters back when it exits, the next
+    // thread keeps counting in them. Threads past this share one set, updated with atomic adds.
+    static constexpr embU32 MAX_THREADS = 128;
+
+    // Any thread.
+    static void RecordAlloc(MemTag tag, embSizeT bytes) noexcept;
+    static void RecordFree(MemTag tag, embSizeT bytes) noexcept;
+
+    // malloc/realloc/free that track under tag. Keep the size in a header in front of the block.
+    static void* Allocate(MemTag tag, embSizeT bytes) noexcept;
+    static void* Reallocate(MemTag tag, void* ptr, embSizeT bytes) noexcept;
+    static void Free(MemTag tag, void* ptr) noexcept;
+
+    // Any thread. Sums all threads' counters for tag.
+    static MemTagStats GetStats(MemTag tag) noexcept;
+    // Any thread. Live bytes over every tag.
+    static embS64 GetTotalLiveBytes() noexcept;
+    // Any thread. Highest live bytes the calling thread's own counters reached for tag, threads that held them before
+    // included.
+    static embS64 GetThreadPeakBytes(MemTag tag) noexcept;
+    // Number of per-thread counter sets in use so far, i.e. the most threads that held counters at once.
+    static embU32 GetThreadCount() noexcept;
+
+    // Folds the current totals into the per-tag peaks. Run once per frame.
+    static void UpdatePeaks() noexcept;
+    // Prints live bytes/allocations per tag. Run at shutdown, anything still live by then is likely a leak.
+    static void PrintReport(const char* when) noexcept;
+};
+
+EMB_NAMESPACE_END
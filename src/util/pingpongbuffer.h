@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// N copies of T handed between one writer thread and one reader thread. The writer fills its buffer and publishes it,
+// the reader always gets the latest published one. Publishing and reading only swap indices, nothing is copied.
+//
+//   writer:  T& buffer = ppb.GetWriteBuffer(); Fill(buffer); ppb.Publish();
+//   reader:  const T& latest = ppb.BeginRead(); Use(latest); ppb.EndRead();
+//
+// N = 3 (triple buffering): a spare buffer sits between the two sides, so neither ever waits or drops anything but
+//        stale frames. EndRead is optional, the read buffer stays valid until the next BeginRead.
+// N = 2 (double buffering): one less copy of T, but Publish fails while the reader is between BeginRead and EndRead.
+//        The writer keeps its buffer and can publish again later, the reader keeps seeing the previous one.
+// After a publish the writer gets back an older buffer with whatever it held, fill it completely every time.
+template<typename T, embU32 N = 3>
+class PingPongBuffer
+{
+    EMB_ASSERT_STATIC(N == 2 || N == 3, "PingPongBuffer supports double (2) or triple (3) buffering");
+
+  public:
+    static constexpr embU32 BUFFER_COUNT = N;
+
+    PingPongBuffer() noexcept = default;
+    PingPongBuffer(const PingPongBuffer&) = delete;
+    PingPongBuffer& operator=(const PingPongBuffer&) = delete;
+
+    // Not thread-safe, for setup before the threads start (e.g. reserving capacity in every buffer).
+    template<typename F>
+    void ForEachBuffer(F&& func) noexcept
+    {
+        for (T& buffer : m_Buffers)
+            func(buffer);
+    }
+
+    //-------------------------------------------------------------------//
+    //                               Writer                              //
+    //-------------------------------------------------------------------//
+
+    // Writer thread only. The buffer being filled, not seen by the reader until Publish.
+    T& GetWriteBuffer() noexcept
+    {
+        return m_Buffers[m_WriteIndex];
+    }
+
+    // Writer thread only. Makes the write buffer the latest one and hands the writer another.
+    // Only fails with N = 2 while the reader is reading, nothing changes in that case.
+    embBool Publish() noexcept
+    {
+        if constexpr (N == 3)
+        {
+            // swap the write buffer with the spare, flag the spare as holding new data.
+            const embU8 oldSpare = m_SharedState.exchange(m_WriteIndex | DIRTY_BIT, std::memory_order_acq_rel);
+            m_WriteIndex = oldSpare & INDEX_MASK;
+            return true;
+        }
+        else
+        {
+            // swap the write buffer with the front buffer, unless the reader holds it.
+            embU8 state = m_SharedState.load(std::memory_order_relaxed);
+            do
+            {
+                if (state & READING_BIT)
+                    return false;
+            } while (!m_SharedState.compare_exchange_weak(state, m_WriteIndex | DIRTY_BIT, std::memory_order_acq_rel,
+                                                          std::memory_order_relaxed));
+
+            m_WriteIndex = state & INDEX_MASK;
+            return true;
+        }
+    }
+
+    //-------------------------------------------------------------------//
+    //                               Reader                              //
+    //-------------------------------------------------------------------//
+
+    // Reader thread only. Returns the latest published buffer, or the one from the last read if nothing new came in.
+    // Before the first publish that is a default constructed T.
+    const T& BeginRead() noexcept
+    {
+        if constexpr (N == 3)
+        {
+            // only swap if something new was published, otherwise keep reading the same front buffer.
+            if (m_SharedState.load(std::memory_order_relaxed) & DIRTY_BIT)
+                m_ReadIndex = m_SharedState.exchange(m_ReadIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        else
+        {
+            EMB_ASSERT_HARD(!m_IsReading, "PingPongBuffer::BeginRead called twice without EndRead");
+            // pin the front buffer so the writer can't swap it out while it's read.
+            const embU8 state = m_SharedState.fetch_or(READING_BIT, std::memory_order_acquire);
+            m_SharedState.fetch_and((embU8)~DIRTY_BIT, std::memory_order_relaxed);
+            m_ReadIndex = state & INDEX_MASK;
+            m_IsReading = true;
+        }
+        return m_Buffers[m_ReadIndex];
+    }
+
+    // Reader thread only. Done with the buffer from BeginRead.
+    void EndRead() noexcept
+    {
+        if constexpr (N == 2)
+        {
+            EMB_ASSERT_HARD(m_IsReading, "PingPongBuffer::EndRead without BeginRead");
+            m_SharedState.fetch_and((embU8)~READING_BIT, std::memory_order_release);
+            m_IsReading = false;
+        }
+    }
+
+    // Any thread. True if something was published since the reader last looked.
+    embBool HasNewData() const noexcept
+    {
+        return m_SharedState.load(std::memory_order_relaxed) & DIRTY_BIT;
+    }
+
+  private:
+    static constexpr embU8 INDEX_MASK = 0b0011;
+    static constexpr embU8 DIRTY_BIT = 0b0100; // published and not read yet
+    static constexpr embU8 READING_BIT = 0b1000; // N = 2 only, reader holds the front buffer
+
+    T m_Buffers[N] {};
+    embU8 m_WriteIndex = 0; // writer only
+    embU8 m_ReadIndex = 1; // reader only
+    embBool m_IsReading = false; // reader only, N = 2
+    // N = 3: the spare buffer's index. N = 2: the front buffer's index. Plus the flags above.
+    std::atomic<embU8> m_SharedState {N == 3 ? 2 : 1};
+};
+
+EMB_NAMESPACE_END
@@ -0,0 +1,267 @@
+#include "poolallocator.h"
+#include "allocator.h"
+#include "macros.h"
+#include "macros_debug.h"
+#include "memtracker.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef EMB_DEF_LINUX
+#    include <sys/mman.h>
+#    include <unistd.h>
+#elif defined(EMB_DEF_WINDOWS)
+#    include <windows.h>
+#endif
+
+EMB_NAMESPACE_START
+
+#ifdef EMB_DEF_DEBUG
+constexpr unsigned char POOL_FILL_ALLOCATED = 0xCD;
+constexpr unsigned char POOL_FILL_FREED = 0xDD;
+#endif
+
+static embSizeT AlignUp(embSizeT value, embSizeT alignment) noexcept
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//-------------------------------------------------------------------//
+//                           Page functions                          //
+//-------------------------------------------------------------------//
+
+static embSizeT GetPageSize() noexcept
+{
+#ifdef EMB_DEF_LINUX
+    return (embSizeT)sysconf(_SC_PAGESIZE);
+#elif defined(EMB_DEF_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (embSizeT)info.dwPageSize;
+#endif
+}
+
+// Read/write pages straight from the OS, page aligned. nullptr on failure.
+static void* MapPages(embSizeT bytes) noexcept
+{
+#ifdef EMB_DEF_LINUX
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#elif defined(EMB_DEF_WINDOWS)
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#endif
+}
+
+static void UnmapPages(void* ptr, embSizeT bytes) noexcept
+{
+#ifdef EMB_DEF_LINUX
+    munmap(ptr, bytes);
+#elif defined(EMB_DEF_WINDOWS)
+    (void)bytes;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#endif
+}
+
+// Any access to the pages faults afterwards.
+static embBool ProtectPages(void* ptr, embSizeT bytes) noexcept
+{
+#ifdef EMB_DEF_LINUX
+    return mprotect(ptr, bytes, PROT_NONE) == 0;
+#elif defined(EMB_DEF_WINDOWS)
+    DWORD oldProtect;
+    return VirtualProtect(ptr, bytes, PAGE_NOACCESS, &oldProtect) != 0;
+#endif
+}
+
+//-------------------------------------------------------------------//
+//                           PoolAllocator                           //
+//-------------------------------------------------------------------//
+
+PoolAllocator::~PoolAllocator() noexcept
+{
+    if (m_Stats.liveBlocks > 0)
+        printf("Warning: PoolAllocator destroyed with %u blocks of %u bytes still allocated\n", m_Stats.liveBlocks, m_Desc.blockSize);
+
+    // guarded blocks are unmapped one by one in Free, whatever is still live is left to the OS.
+    for (void* slab : m_Slabs)
+    {
+        MemTracker::RecordFree(m_Desc.memTag, m_SlabBytes);
+        RawHeapAllocator::Free(slab, m_SlabBytes, m_Desc.blockAlignment);
+    }
+}
+
+void PoolAllocator::Init(const PoolDesc& desc) noexcept
+{
+    EMB_ASSERT_HARD(m_BlockStride == 0, "PoolAllocator initialized twice");
+    EMB_ASSERT_HARD(desc.blockSize > 0 && desc.blocksPerSlab > 0, "PoolAllocator needs a block size and slab size");
+    EMB_ASSERT_HARD((desc.blockAlignment & (desc.blockAlignment - 1)) == 0, "PoolAllocator alignment must be a power of two");
+
+    m_Desc = desc;
+    m_Desc.blockAlignment = std::max(desc.blockAlignment, (embU32)alignof(FreeBlock));
+    m_BlockStride = (embU32)AlignUp(std::max(desc.blockSize, (embU32)sizeof(FreeBlock)), m_Desc.blockAlignment);
+    m_SlabBytes = (embSizeT)m_BlockStride * desc.blocksPerSlab;
+
+#ifdef EMB_DEF_DEBUG
+    if (m_Desc.useGuardPages)
+    {
+        const embSizeT pageSize = GetPageSize();
+        EMB_ASSERT_HARD(m_Desc.blockAlignment <= pageSize, "PoolAllocator guard pages can't align blocks past a page");
+        m_GuardedBytes = AlignUp(m_Desc.blockSize, pageSize) + pageSize;
+    }
+#else
+    m_Desc.useGuardPages = false;
+#endif
+}
+
+void* PoolAllocator::Allocate() noexcept
+{
+    EMB_ASSERT_HARD(m_BlockStride != 0, "PoolAllocator used before Init");
+    if (EMB_BRANCH_UNLIKELY(m_Desc.useGuardPages))
+        return AllocateGuarded();
+
+    Lock();
+    if (m_FreeList == nullptr)
+        AddSlab();
+
+    FreeBlock* block = m_FreeList;
+    m_FreeList = block->next;
+    m_Stats.liveBlocks++;
+    m_Stats.peakLiveBlocks = std::max(m_Stats.peakLiveBlocks, m_Stats.liveBlocks);
+    Unlock();
+
+#ifdef EMB_DEF_DEBUG
+    memset(block, POOL_FILL_ALLOCATED, m_Desc.blockSize);
+#endif
+    return block;
+}
+
+void PoolAllocator::Free(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    if (EMB_BRANCH_UNLIKELY(m_Desc.useGuardPages))
+        return FreeGuarded(ptr);
+
+    EMB_ASSERT_HARD(Owns(ptr), "PoolAllocator freeing a block it doesn't own");
+#ifdef EMB_DEF_DEBUG
+    memset(ptr, POOL_FILL_FREED, m_BlockStride);
+#endif
+
+    FreeBlock* block = (FreeBlock*)ptr;
+    Lock();
+    EMB_ASSERT_HARD(m_Stats.liveBlocks > 0, "PoolAllocator freed more blocks than it allocated");
+    block->next = m_FreeList;
+    m_FreeList = block;
+    m_Stats.liveBlocks--;
+    Unlock();
+}
+
+embBool PoolAllocator::Owns(const void* ptr) const noexcept
+{
+    const unsigned char* bytes = (const unsigned char*)ptr;
+    Lock();
+    const embBool owns = std::any_of(m_Slabs.begin(), m_Slabs.end(), [&](void* slab) {
+        const unsigned char* slabStart = (const unsigned char*)slab;
+        return bytes >= slabStart && bytes < slabStart + m_SlabBytes && (embSizeT)(bytes - slabStart) % m_BlockStride == 0;
+    });
+    Unlock();
+    return owns;
+}
+
+void PoolAllocator::AddSlab() noexcept
+{
+    unsigned char* slab = (unsigned char*)RawHeapAllocator::Allocate(m_SlabBytes, m_Desc.blockAlignment);
+    MemTracker::RecordAlloc(m_Desc.memTag, m_SlabBytes);
+    m_Slabs.push_back(slab);
+    m_Stats.slabCount++;
+    m_Stats.reservedBytes += m_SlabBytes;
+
+    // link back to front, so blocks are handed out in address order.
+    for (embU32 i = m_Desc.blocksPerSlab; i-- > 0;)
+    {
+        FreeBlock* block = (FreeBlock*)(slab + (embSizeT)i * m_BlockStride);
+        block->next = m_FreeList;
+        m_FreeList = block;
+    }
+}
+
+void* PoolAllocator::AllocateGuarded() noexcept
+{
+    const embSizeT pageSize = GetPageSize();
+    unsigned char* pages = (unsigned char*)MapPages(m_GuardedBytes);
+    EMB_ASSERT_HARD(pages != nullptr, "PoolAllocator could not map guard pages");
+
+    unsigned char* guard = pages + m_GuardedBytes - pageSize;
+    const embBool isProtected = ProtectPages(guard, pageSize);
+    EMB_ASSERT_HARD(isProtected, "PoolAllocator could not protect guard page");
+    (void)isProtected;
+    MemTracker::RecordAlloc(m_Desc.memTag, m_GuardedBytes);
+
+    // block ends as close to the guard page as its alignment allows.
+    unsigned char* block = (unsigned char*)((std::uintptr_t)(guard - m_Desc.blockSize) & ~(std::uintptr_t)(m_Desc.blockAlignment - 1));
+
+    Lock();
+    m_Stats.liveBlocks++;
+    m_Stats.peakLiveBlocks = std::max(m_Stats.peakLiveBlocks, m_Stats.liveBlocks);
+    m_Stats.reservedBytes += m_GuardedBytes;
+    Unlock();
+
+#ifdef EMB_DEF_DEBUG
+    memset(block, POOL_FILL_ALLOCATED, m_Desc.blockSize);
+#endif
+    return block;
+}
+
+void PoolAllocator::FreeGuarded(void* ptr) noexcept
+{
+    // the block always ends within alignment bytes of the guard page, so rounding its end up finds the guard page.
+    const embSizeT pageSize = GetPageSize();
+    const std::uintptr_t guard = AlignUp((std::uintptr_t)ptr + m_Desc.blockSize, pageSize);
+    UnmapPages((void*)(guard + pageSize - m_GuardedBytes), m_GuardedBytes);
+    MemTracker::RecordFree(m_Desc.memTag, m_GuardedBytes);
+
+    Lock();
+    EMB_ASSERT_HARD(m_Stats.liveBlocks > 0, "PoolAllocator freed more blocks than it allocated");
+    m_Stats.liveBlocks--;
+    m_Stats.reservedBytes -= m_GuardedBytes;
+    Unlock();
+}
+
+embU32 PoolAllocator::GetBlockSize() const noexcept
+{
+    return m_Desc.blockSize;
+}
+
+embU32 PoolAllocator::GetBlockAlignment() const noexcept
+{
+    return m_Desc.blockAlignment;
+}
+
+embBool PoolAllocator::IsUsingGuardPages() const noexcept
+{
+    return m_Desc.useGuardPages;
+}
+
+PoolStats PoolAllocator::GetStats() const noexcept
+{
+    Lock();
+    const PoolStats stats = m_Stats;
+    Unlock();
+    return stats;
+}
+
+void PoolAllocator::Lock() const noexcept
+{
+    while (m_Lock.test_and_set(std::memory_order_acquire))
+        EMB_CPU_PAUSE();
+}
+
+void PoolAllocator::Unlock() const noexcept
+{
+    m_Lock.clear(std::memory_order_release);
+}
+
+EMB_NAMESPACE_END
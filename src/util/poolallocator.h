@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "compactarray.h"
+#include "macros.h"
+#include "macros_debug.h"
+#include "memtracker.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+struct PoolDesc
+{
+    embU32 blockSize = 64; // bytes per block, what the largest object put in the pool needs
+    embU32 blockAlignment = alignof(std::max_align_t);
+    embU32 blocksPerSlab = 64; // blocks grabbed from the heap at once when the free list runs dry
+    embBool useGuardPages = false; // debug builds only, ignored in release. See PoolAllocator.
+    MemTag memTag = MemTag::GENERAL; // slabs (or guarded pages) are counted under this
+};
+
+struct PoolStats
+{
+    embU32 liveBlocks = 0; // allocated and not freed yet
+    embU32 peakLiveBlocks = 0;
+    embU32 slabCount = 0;
+    embSizeT reservedBytes = 0; // heap (or pages) held by the pool, live or not
+};
+
+// Fixed-size block allocator. Blocks are carved out of slabs of blocksPerSlab blocks, and freed blocks go onto an
+// intrusive free list, so Allocate and Free are O(1) and loading/unloading lots of small objects never fragments the
+// general heap. Slabs are only given back when the pool is destroyed.
+// Thread-safe, behind a spin lock held for a handful of instructions.
+//
+// Guard pages (debug only): every block gets pages of its own, placed right before an inaccessible guard page, and
+// Free unmaps them. Writing past the end of a block (beyond its alignment padding) or touching a freed block crashes
+// on the spot instead of corrupting a neighbour. Costs at least two pages per block, meant for hunting bugs in one
+// pool at a time.
+class PoolAllocator
+{
+  public:
+    PoolAllocator() noexcept = default;
+    ~PoolAllocator() noexcept;
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    // Run once before use.
+    void Init(const PoolDesc& desc) noexcept;
+
+    // Never returns nullptr. The block holds garbage (debug: 0xCD).
+    void* Allocate() noexcept;
+    // ptr must come from this pool's Allocate. nullptr is ignored.
+    void Free(void* ptr) noexcept;
+
+    // True if ptr lies in one of this pool's slabs. Not supported with guard pages (always false).
+    embBool Owns(const void* ptr) const noexcept;
+
+    embU32 GetBlockSize() const noexcept;
+    embU32 GetBlockAlignment() const noexcept;
+    embBool IsUsingGuardPages() const noexcept;
+    // Snapshot of the counters. Any thread.
+    PoolStats GetStats() const noexcept;
+
+  private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    void Lock() const noexcept;
+    void Unlock() const noexcept;
+
+    // Carves a new slab into blocks on the free list. Lock held.
+    void AddSlab() noexcept;
+
+    void* AllocateGuarded() noexcept;
+    void FreeGuarded(void* ptr) noexcept;
+
+    PoolDesc m_Desc;
+    embU32 m_BlockStride = 0; // block size rounded up to the alignment, and to fit a free list link
+    embSizeT m_SlabBytes = 0;
+    embSizeT m_GuardedBytes = 0; // pages mapped per guarded block, guard page included
+
+    FreeBlock* m_FreeList = nullptr;
+    CompactArray<void*, embU32> m_Slabs;
+    PoolStats m_Stats;
+
+    mutable std::atomic_flag m_Lock = ATOMIC_FLAG_INIT;
+};
+
+EMB_NAMESPACE_END
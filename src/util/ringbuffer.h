@@ -0,0 +1,376 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "macros.h"
+#include "macros_debug.h"
+#include "types.h"
+
+EMB_NAMESPACE_START
+
+// Fixed-capacity ring buffers. Storage lives inside the object, so pushing and popping never allocate.
+// N must be a power of two, indices wrap with a mask instead of a modulo.
+//   RingBuffer     : single thread, FIFO with random access, can overwrite the oldest element when full.
+//   SpscRingBuffer : one producer thread, one consumer thread, lock-free.
+//   MpmcRingBuffer : any number of producers and consumers, lock-free (bounded, Vyukov style).
+// Indices written by different threads sit on their own cache lines so producers and consumers don't false share.
+
+//-------------------------------------------------------------------//
+//                             RingBuffer                            //
+//-------------------------------------------------------------------//
+
+template<typename T, embU32 N>
+class RingBuffer
+{
+    EMB_ASSERT_STATIC(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+  public:
+    static constexpr embU32 CAPACITY = N;
+
+    RingBuffer() noexcept = default;
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    ~RingBuffer() noexcept
+    {
+        Clear();
+    }
+
+    // Returns false (and constructs nothing) if full.
+    template<typename... Args>
+    embBool TryEmplace(Args&&... args) noexcept
+    {
+        if (IsFull())
+            return false;
+
+        std::construct_at(GetSlot(m_Tail), std::forward<Args>(args)...);
+        m_Tail++;
+        return true;
+    }
+    embBool TryPush(const T& value) noexcept
+    {
+        return TryEmplace(value);
+    }
+    embBool TryPush(T&& value) noexcept
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    // Drops the oldest element if full. For history and log buffers where only the latest N matter.
+    template<typename... Args>
+    T& EmplaceOverwrite(Args&&... args) noexcept
+    {
+        if (IsFull())
+            PopFront();
+
+        T* element = std::construct_at(GetSlot(m_Tail), std::forward<Args>(args)...);
+        m_Tail++;
+        return *element;
+    }
+    T& PushOverwrite(const T& value) noexcept
+    {
+        return EmplaceOverwrite(value);
+    }
+    T& PushOverwrite(T&& value) noexcept
+    {
+        return EmplaceOverwrite(std::move(value));
+    }
+
+    // Moves the oldest element into out. Returns false if empty.
+    embBool TryPop(T& out) noexcept
+    {
+        if (IsEmpty())
+            return false;
+
+        out = std::move(Front());
+        PopFront();
+        return true;
+    }
+
+    void PopFront() noexcept
+    {
+        EMB_ASSERT_HARD(!IsEmpty(), "PopFront on an empty RingBuffer");
+        std::destroy_at(GetSlot(m_Head));
+        m_Head++;
+    }
+
+    void Clear() noexcept
+    {
+        while (!IsEmpty())
+            PopFront();
+        m_Head = m_Tail = 0;
+    }
+
+    // index 0 is the oldest element.
+    T& operator[](embU32 index) noexcept
+    {
+        EMB_ASSERT_HARD(index < GetSize(), "RingBuffer index out of range");
+        return *GetSlot(m_Head + index);
+    }
+    const T& operator[](embU32 index) const noexcept
+    {
+        EMB_ASSERT_HARD(index < GetSize(), "RingBuffer index out of range");
+        return *GetSlot(m_Head + index);
+    }
+
+    T& Front() noexcept
+    {
+        return (*this)[0];
+    }
+    const T& Front() const noexcept
+    {
+        return (*this)[0];
+    }
+    T& Back() noexcept
+    {
+        return (*this)[GetSize() - 1];
+    }
+    const T& Back() const noexcept
+    {
+        return (*this)[GetSize() - 1];
+    }
+
+    embU32 GetSize() const noexcept
+    {
+        return m_Tail - m_Head; // both only grow, unsigned wrap keeps the difference right
+    }
+    embBool IsEmpty() const noexcept
+    {
+        return m_Tail == m_Head;
+    }
+    embBool IsFull() const noexcept
+    {
+        return GetSize() == N;
+    }
+
+  private:
+    T* GetSlot(embU32 position) noexcept
+    {
+        return std::launder((T*)m_Storage) + (position & (N - 1));
+    }
+    const T* GetSlot(embU32 position) const noexcept
+    {
+        return std::launder((const T*)m_Storage) + (position & (N - 1));
+    }
+
+    embU32 m_Head = 0; // next to pop
+    embU32 m_Tail = 0; // next to push
+    alignas(T) unsigned char m_Storage[sizeof(T) * N];
+};
+
+//-------------------------------------------------------------------//
+//                           SpscRingBuffer                          //
+//-------------------------------------------------------------------//
+
+// Each side keeps a stale copy of the other side's index and only reloads it when the ring looks full (producer) or
+// empty (consumer), so most pushes and pops touch no shared cache line besides the slot itself.
+template<typename T, embU32 N>
+class SpscRingBuffer
+{
+    EMB_ASSERT_STATIC(N > 0 && (N & (N - 1)) == 0, "SpscRingBuffer capacity must be a power of two");
+
+  public:
+    static constexpr embU32 CAPACITY = N;
+
+    SpscRingBuffer() noexcept = default;
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+    ~SpscRingBuffer() noexcept
+    {
+        const embU64 tail = m_Tail.load(std::memory_order_relaxed);
+        for (embU64 head = m_Head.load(std::memory_order_relaxed); head != tail; head++)
+            std::destroy_at(GetSlot(head));
+    }
+
+    // Producer thread only. Returns false (and constructs nothing) if full.
+    template<typename... Args>
+    embBool TryEmplace(Args&&... args) noexcept
+    {
+        const embU64 tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_CachedHead == N)
+        {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead == N)
+                return false;
+        }
+
+        std::construct_at(GetSlot(tail), std::forward<Args>(args)...);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    embBool TryPush(const T& value) noexcept
+    {
+        return TryEmplace(value);
+    }
+    embBool TryPush(T&& value) noexcept
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    // Consumer thread only. Moves the oldest element into out. Returns false if empty.
+    embBool TryPop(T& out) noexcept
+    {
+        const embU64 head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_CachedTail)
+        {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail)
+                return false;
+        }
+
+        T* element = GetSlot(head);
+        out = std::move(*element);
+        std::destroy_at(element);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any thread. Approximate while the other side is working.
+    embU32 GetSize() const noexcept
+    {
+        const embU64 head = m_Head.load(std::memory_order_acquire);
+        return (embU32)(m_Tail.load(std::memory_order_acquire) - head);
+    }
+    embBool IsEmpty() const noexcept
+    {
+        return GetSize() == 0;
+    }
+
+  private:
+    T* GetSlot(embU64 position) noexcept
+    {
+        return std::launder((T*)m_Storage) + (position & (N - 1));
+    }
+
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_Head = 0; // consumer writes
+    embU64 m_CachedTail = 0; // consumer only
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_Tail = 0; // producer writes
+    embU64 m_CachedHead = 0; // producer only
+    alignas(EMB_CACHE_LINE_SIZE) alignas(T) unsigned char m_Storage[sizeof(T) * N];
+};
+
+//-------------------------------------------------------------------//
+//                           MpmcRingBuffer                          //
+//-------------------------------------------------------------------//
+
+// Each slot carries a sequence number saying whose turn it is, producers and consumers claim positions with a CAS.
+// Same scheme as MainThreadQueue, for plain values and with any number of consumers.
+template<typename T, embU32 N>
+class MpmcRingBuffer
+{
+    EMB_ASSERT_STATIC(N > 0 && (N & (N - 1)) == 0, "MpmcRingBuffer capacity must be a power of two");
+
+  public:
+    static constexpr embU32 CAPACITY = N;
+
+    MpmcRingBuffer() noexcept
+    {
+        for (embU32 i = 0; i < N; i++)
+            m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+    MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+    ~MpmcRingBuffer() noexcept
+    {
+        const embU64 enqueuePos = m_EnqueuePos.load(std::memory_order_relaxed);
+        for (embU64 position = m_DequeuePos.load(std::memory_order_relaxed); position != enqueuePos; position++)
+            std::destroy_at(m_Slots[position & (N - 1)].GetValue());
+    }
+
+    // Any thread. Returns false (and constructs nothing) if full.
+    template<typename... Args>
+    embBool TryEmplace(Args&&... args) noexcept
+    {
+        embU64 position = m_EnqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = m_Slots[position & (N - 1)];
+            const embU64 sequence = slot.sequence.load(std::memory_order_acquire);
+            const embS64 diff = (embS64)(sequence - position);
+
+            if (diff == 0)
+            {
+                if (m_EnqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    std::construct_at(slot.GetValue(), std::forward<Args>(args)...);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // a lap behind, full
+            else
+                position = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    embBool TryPush(const T& value) noexcept
+    {
+        return TryEmplace(value);
+    }
+    embBool TryPush(T&& value) noexcept
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    // Any thread. Moves the oldest element into out. Returns false if empty.
+    embBool TryPop(T& out) noexcept
+    {
+        embU64 position = m_DequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = m_Slots[position & (N - 1)];
+            const embU64 sequence = slot.sequence.load(std::memory_order_acquire);
+            const embS64 diff = (embS64)(sequence - (position + 1));
+
+            if (diff == 0)
+            {
+                if (m_DequeuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    T* element = slot.GetValue();
+                    out = std::move(*element);
+                    std::destroy_at(element);
+                    slot.sequence.store(position + N, std::memory_order_release); // free for the next lap
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // not published yet, empty
+            else
+                position = m_DequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. Approximate while others are pushing or popping.
+    embU32 GetSize() const noexcept
+    {
+        const embU64 dequeuePos = m_DequeuePos.load(std::memory_order_relaxed);
+        const embU64 enqueuePos = m_EnqueuePos.load(std::memory_order_relaxed);
+        return enqueuePos > dequeuePos ? (embU32)(enqueuePos - dequeuePos) : 0;
+    }
+    embBool IsEmpty() const noexcept
+    {
+        return GetSize() == 0;
+    }
+
+  private:
+    struct Slot
+    {
+        // == position when free for that lap's producer, position + 1 once published for the consumer.
+        std::atomic<embU64> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* GetValue() noexcept
+        {
+            return std::launder((T*)storage);
+        }
+    };
+
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_EnqueuePos = 0; // producers
+    alignas(EMB_CACHE_LINE_SIZE) std::atomic<embU64> m_DequeuePos = 0; // consumers
+    alignas(EMB_CACHE_LINE_SIZE) Slot m_Slots[N];
+};
+
+EMB_NAMESPACE_END
@@ -50,14 +50,14 @@ EMB_NAMESPACE_START
 /// <param name="maxReplacements">maximum number of replacements to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start replacing from the back to front instead of front to back.</param>
 /// <return>number of times a replacement happens.</return>
-size_t StrReplace(std::string& toModify, std::string_view toReplace, std::string_view replaceWith,
+size_t StrReplace(embStr& toModify, std::string_view toReplace, std::string_view replaceWith,
                   size_t maxReplacements, bool startFromBack)
 {
     size_t count = 0;
     if (!startFromBack)
     {
-        for (std::string::size_type pos = 0;
-             std::string::npos != (pos = toModify.find(toReplace.data(), pos, toReplace.length()));
+        for (embStr::size_type pos = 0;
+             embStr::npos != (pos = toModify.find(toReplace.data(), pos, toReplace.length()));
              pos += replaceWith.length())
         {
             toModify.replace(pos, toReplace.length(), replaceWith.data(), replaceWith.length());
@@ -68,8 +68,8 @@ size_t StrReplace(std::string& toModify, std::string_view toReplace, std::string
     }
     else
     {
-        for (std::string::size_type pos = toModify.length() - 1;
-             std::string::npos != (pos = toModify.rfind(toReplace.data(), pos, toReplace.length()));
+        for (embStr::size_type pos = toModify.length() - 1;
+             embStr::npos != (pos = toModify.rfind(toReplace.data(), pos, toReplace.length()));
              pos -= toReplace.length())
         {
             toModify.replace(pos, toReplace.length(), replaceWith.data(), replaceWith.length());
@@ -90,7 +90,7 @@ size_t StrReplace(std::string& toModify, std::string_view toReplace, std::string
 /// <param name="maxReplacements">maximum number of replacements to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a replacement happened.</return>
-size_t StrReplace(std::string& toModify, const char toReplace, const char replaceWith,
+size_t StrReplace(embStr& toModify, const char toReplace, const char replaceWith,
                   size_t maxReplacements, bool startFromBack)
 {
     size_t count = 0;
@@ -134,14 +134,14 @@ size_t StrReplace(std::string& toModify, const char toReplace, const char replac
 /// <param name="maxRemoves">maximum number of removes to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a remove happened.</return>
-size_t StrRemove(std::string& toModify, std::string_view toRemove, size_t maxRemoves,
+size_t StrRemove(embStr& toModify, std::string_view toRemove, size_t maxRemoves,
                  bool startFromBack)
 {
     size_t count = 0;
     if (!startFromBack)
     {
-        for (std::string::size_type pos = 0;
-             std::string::npos != (pos = toModify.find(toRemove.data(), pos, toRemove.length()));)
+        for (embStr::size_type pos = 0;
+             embStr::npos != (pos = toModify.find(toRemove.data(), pos, toRemove.length()));)
         {
             toModify.erase(pos, toRemove.length());
             count++;
@@ -151,8 +151,8 @@ size_t StrRemove(std::string& toModify, std::string_view toRemove, size_t maxRem
     }
     else
     {
-        for (std::string::size_type pos = toModify.length() - 1;
-             std::string::npos != (pos = toModify.rfind(toRemove.data(), pos, toRemove.length()));
+        for (embStr::size_type pos = toModify.length() - 1;
+             embStr::npos != (pos = toModify.rfind(toRemove.data(), pos, toRemove.length()));
              pos -= toRemove.length())
         {
             toModify.erase(pos, toRemove.length());
@@ -172,13 +172,13 @@ size_t StrRemove(std::string& toModify, std::string_view toRemove, size_t maxRem
 /// <param name="maxRemoves">maximum number of removes to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a remove happened.</return>
-size_t StrRemove(std::string& toModify, const char toRemove, size_t maxRemoves, bool startFromBack)
+size_t StrRemove(embStr& toModify, const char toRemove, size_t maxRemoves, bool startFromBack)
 {
     size_t count = 0;
     if (!startFromBack)
     {
-        for (std::string::size_type pos = 0;
-             std::string::npos
+        for (embStr::size_type pos = 0;
+             embStr::npos
              != (pos = toModify.find_first_of(*const_cast<char*>(&toRemove), pos));)
         {
             toModify.erase(pos, 1);
@@ -189,8 +189,8 @@ size_t StrRemove(std::string& toModify, const char toRemove, size_t maxRemoves,
     }
     else
     {
-        for (std::string::size_type pos = toModify.length() - 1;
-             std::string::npos != (pos = toModify.find_last_of(*const_cast<char*>(&toRemove), pos));
+        for (embStr::size_type pos = toModify.length() - 1;
+             embStr::npos != (pos = toModify.find_last_of(*const_cast<char*>(&toRemove), pos));
              pos--)
         {
             toModify.erase(pos, 1);
@@ -207,16 +207,16 @@ size_t StrRemove(std::string& toModify, const char toRemove, size_t maxRemoves,
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the front/back, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrim(std::string_view str, std::string_view charsToTrim)
+embStr StrTrim(std::string_view str, std::string_view charsToTrim)
 {
     if (str.empty() || charsToTrim.empty())
-        return std::string(str);
+        return embStr(str);
 
     size_t frontpos = str.find_first_not_of(charsToTrim);
-    if (frontpos == std::string::npos)
-        return std::string(str);
+    if (frontpos == embStr::npos)
+        return embStr(str);
     size_t backpos = str.find_last_not_of(charsToTrim);
-    return std::string(str.substr(frontpos, backpos - frontpos + 1));
+    return embStr(str.substr(frontpos, backpos - frontpos + 1));
 }
 /// <summary>
 /// Removes trailing characters at the front of the string, specified by charsToTrim.
@@ -224,15 +224,15 @@ std::string StrTrim(std::string_view str, std::string_view charsToTrim)
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the front, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrimFront(std::string_view str, std::string_view charsToTrim)
+embStr StrTrimFront(std::string_view str, std::string_view charsToTrim)
 {
     if (str.empty() || charsToTrim.empty())
-        return std::string(str);
+        return embStr(str);
 
     size_t frontpos = str.find_first_not_of(charsToTrim);
-    if (frontpos == std::string::npos)
-        return std::string(str);
-    return std::string(str.substr(frontpos, str.size() - frontpos + 1));
+    if (frontpos == embStr::npos)
+        return embStr(str);
+    return embStr(str.substr(frontpos, str.size() - frontpos + 1));
 }
 /// <summary>
 /// Removes trailing characters at the back of the string, specified by charsToTrim.
@@ -240,14 +240,14 @@ std::string StrTrimFront(std::string_view str, std::string_view charsToTrim)
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the back, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrimBack(std::string_view str, std::string_view charsToTrim)
+embStr StrTrimBack(std::string_view str, std::string_view charsToTrim)
 {
     if (str.empty() || charsToTrim.empty())
-        return std::string(str);
+        return embStr(str);
     size_t backpos = str.find_last_not_of(charsToTrim);
-    if (backpos == std::string::npos)
-        return std::string(str);
-    return std::string(str.substr(0, backpos + 1));
+    if (backpos == embStr::npos)
+        return embStr(str);
+    return embStr(str.substr(0, backpos + 1));
 }
 
 // /// <summary>
@@ -258,36 +258,10 @@ std::string StrTrimBack(std::string_view str, std::string_view charsToTrim)
 // /// <param name="toSplit">the string to be split.</param>
 // /// <param name="delimiters">delimiter characters to use to mark where to split the string. can use multiple characters at once.</param>
 // /// <returns>vector of strings that have been split.</returns>
-std::vector<std::string> StrSplit(std::string_view toSplit, std::string_view delimiters)
+StrSplitResult StrSplit(std::string_view toSplit, std::string_view delimiters)
 {
-    std::vector<std::string> ret;
-    if (toSplit.empty() || delimiters.empty())
-        return ret;
-
-    size_t currentPos = 0;
-    size_t nextDelim = toSplit.find_first_of(delimiters);
-
-    // Skip start trailing delims if any. set the start pos and next delim to the correct positions.
-    if (nextDelim == 0)
-    {
-        currentPos = toSplit.find_first_not_of(delimiters);
-        nextDelim = toSplit.find_first_of(delimiters, currentPos);
-    }
-
-    while (nextDelim != std::string::npos)
-    {
-        ret.emplace_back(toSplit.substr(currentPos, nextDelim - currentPos));
-        currentPos = toSplit.find_first_not_of(delimiters, nextDelim);
-        nextDelim = toSplit.find_first_of(delimiters, currentPos);
-    }
-
-    // Handle case where there is no trailing delim. nextDelim is npos, currentPos exists.
-    // pushback currentPos to end of string.
-    if (currentPos != std::string::npos && nextDelim == std::string::npos)
-    {
-        ret.emplace_back(toSplit.substr(currentPos, toSplit.size() - currentPos));
-    }
-
+    StrSplitResult ret;
+    StrSplitInto(ret, toSplit, delimiters);
     return ret;
 }
 
@@ -296,9 +270,9 @@ std::vector<std::string> StrSplit(std::string_view toSplit, std::string_view del
 /// </summary>
 /// <param name="str">string to convert</param>
 /// <returns>copy of a string that is upper-cased</returns>
-std::string StrToUpper(std::string_view str)
+embStr StrToUpper(std::string_view str)
 {
-    std::string ret(str);
+    embStr ret(str);
     for (auto& c : ret)
         c = (char)toupper(c);
     return ret;
@@ -308,9 +282,9 @@ std::string StrToUpper(std::string_view str)
 /// </summary>
 /// <param name="str">string to convert</param>
 /// <returns>copy of a string that is lower-cased</returns>
-std::string StrToLower(std::string_view str)
+embStr StrToLower(std::string_view str)
 {
-    std::string ret(str);
+    embStr ret(str);
     for (auto& c : ret)
         c = (char)tolower(c);
     return ret;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "allocator.h"
+#include "inplacearray.h"
 #include "types.h"
 #include <string>
 #include <string_view>
@@ -8,7 +10,7 @@
 EMB_NAMESPACE_START
 
 // strings and stuff
-using embStr = std::string;
+using embStr = std::basic_string<char, std::char_traits<char>, TaggedStdAllocator<char, MemTag::STRINGS>>; // counted by MemTracker
 using embWstr = std::wstring;
 using embStrView = std::string_view;
 
@@ -42,7 +44,7 @@ constexpr std::string_view WHITESPACE_CHARS = " \f\n\r\t\v";
 /// <param name="maxReplacements">maximum number of replacements to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start replacing from the back to front instead of front to back.</param>
 /// <return>number of times a replacement happens.</return>
-size_t StrReplace(std::string& toModify, std::string_view toReplace, std::string_view replaceWith,
+size_t StrReplace(embStr& toModify, std::string_view toReplace, std::string_view replaceWith,
                   size_t maxReplacements = 0, bool startFromBack = false);
 
 /// <summary>
@@ -54,7 +56,7 @@ size_t StrReplace(std::string& toModify, std::string_view toReplace, std::string
 /// <param name="maxReplacements">maximum number of replacements to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a replacement happened.</return>
-size_t StrReplace(std::string& toModify, const char toReplace, const char replaceWith,
+size_t StrReplace(embStr& toModify, const char toReplace, const char replaceWith,
                   size_t maxReplacements = 0, bool startFromBack = false);
 
 /// <summary>
@@ -65,7 +67,7 @@ size_t StrReplace(std::string& toModify, const char toReplace, const char replac
 /// <param name="maxRemoves">maximum number of removes to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a remove happened.</return>
-size_t StrRemove(std::string& toModify, std::string_view toRemove, size_t maxRemoves = 0,
+size_t StrRemove(embStr& toModify, std::string_view toRemove, size_t maxRemoves = 0,
                  bool startFromBack = false);
 
 /// <summary>
@@ -76,7 +78,7 @@ size_t StrRemove(std::string& toModify, std::string_view toRemove, size_t maxRem
 /// <param name="maxRemoves">maximum number of removes to perform. 0 means unlimited.</param>
 /// <param name="startFromBack">Start iterating from the back to front instead of front to back.</param>
 /// <return>number of times a remove happened.</return>
-size_t StrRemove(std::string& toModify, const char toRemove, size_t maxRemoves = 0,
+size_t StrRemove(embStr& toModify, const char toRemove, size_t maxRemoves = 0,
                  bool startFromBack = false);
 /// <summary>
 /// Removes trailing characters at the front and back of the string, specified by charsToTrim.
@@ -84,21 +86,25 @@ size_t StrRemove(std::string& toModify, const char toRemove, size_t maxRemoves =
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the front/back, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrim(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
+embStr StrTrim(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
 /// <summary>
 /// Removes trailing characters at the front of the string, specified by charsToTrim.
 /// </summary>
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the front, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrimFront(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
+embStr StrTrimFront(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
 /// <summary>
 /// Removes trailing characters at the back of the string, specified by charsToTrim.
 /// </summary>
 /// <param name="str">the string to trim</param>
 /// <param name="charsToTrim">the characters that are to be considered unwanted at the back, to be removed</param>
 /// <returns>the trimmed string</returns>
-std::string StrTrimBack(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
+embStr StrTrimBack(std::string_view str, std::string_view charsToTrim = WHITESPACE_CHARS);
+
+// StrSplit results are usually a handful of tokens, keep those off the heap.
+constexpr embU32 STRSPLIT_INPLACE_COUNT = 8;
+using StrSplitResult = InplaceArray<embStr, STRSPLIT_INPLACE_COUNT>;
 
 /// <summary>
 /// Splits a string container into a vector of strings, using the delimiters provided.
@@ -107,21 +113,59 @@ std::string StrTrimBack(std::string_view str, std::string_view charsToTrim = WHI
 /// </summary>
 /// <param name="toSplit">the string to be split.</param>
 /// <param name="delimiters">delimiter characters to use to mark where to split the string. can use multiple characters at once.</param>
-/// <returns>vector of strings that have been split.</returns>
-std::vector<std::string> StrSplit(std::string_view toSplit, std::string_view delimiters = " ");
+/// <returns>vector of strings that have been split. Up to STRSPLIT_INPLACE_COUNT strings are kept inline.</returns>
+StrSplitResult StrSplit(std::string_view toSplit, std::string_view delimiters = " ");
+
+/// <summary>
+/// Same as StrSplit, but appends the split strings to any container with emplace_back, e.g. to pick where they are
+/// allocated from (embFrameArray of embFrameStr in engine/framearena.h).
+/// </summary>
+/// <param name="out">container to append the split strings to. Its value_type must be constructible from a string_view.</param>
+/// <param name="toSplit">the string to be split.</param>
+/// <param name="delimiters">delimiter characters to use to mark where to split the string. can use multiple characters at once.</param>
+template<typename Container>
+void StrSplitInto(Container& out, std::string_view toSplit, std::string_view delimiters = " ")
+{
+    if (toSplit.empty() || delimiters.empty())
+        return;
+
+    size_t currentPos = 0;
+    size_t nextDelim = toSplit.find_first_of(delimiters);
+
+    // Skip start trailing delims if any. set the start pos and next delim to the correct positions.
+    if (nextDelim == 0)
+    {
+        currentPos = toSplit.find_first_not_of(delimiters);
+        nextDelim = toSplit.find_first_of(delimiters, currentPos);
+    }
+
+    while (nextDelim != embStr::npos)
+    {
+        out.emplace_back(toSplit.substr(currentPos, nextDelim - currentPos));
+        currentPos = toSplit.find_first_not_of(delimiters, nextDelim);
+        nextDelim = toSplit.find_first_of(delimiters, currentPos);
+    }
+
+    // Handle case where there is no trailing delim. nextDelim is npos, currentPos exists.
+    // pushback currentPos to end of string.
+    if (currentPos != embStr::npos && nextDelim == embStr::npos)
+    {
+        out.emplace_back(toSplit.substr(currentPos, toSplit.size() - currentPos));
+    }
+}
 
 /// <summary>
 /// Converts a string to upper case.
 /// </summary>
 /// <param name="str">string to convert</param>
 /// <returns>copy of a string that is upper-cased</returns>
-std::string StrToUpper(std::string_view str);
+embStr StrToUpper(std::string_view str);
 /// <summary>
 /// Converts a string to lower case.
 /// </summary>
 /// <param name="str">string to convert</param>
 /// <returns>copy of a string that is lower-cased</returns>
-std::string StrToLower(std::string_view str);
+embStr StrToLower(std::string_view str);
 
 /// <summary>
 /// Checks if a string starts with a sequence of characters
@@ -144,11 +188,11 @@ bool StrEndsWith(std::string_view str, std::string_view endsWith);
 /// <param name="args">string types to concatenate. (string, string_view, c-strings)</param>
 /// <returns>Returns a concatenated string.</returns>
 template <typename... T>
-std::string StrConcat(const T&... args)
+embStr StrConcat(const T&... args)
 {
-    std::string ret;
+    embStr ret;
     std::string_view views[]{args...};
-    std::string::size_type full_size = 0;
+    embStr::size_type full_size = 0;
     for (const auto& sub_view : views)
         full_size += sub_view.size();
     ret.reserve(full_size);